@@ -5,6 +5,13 @@
 #include <optional>
 #include <filesystem>
 #include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <ctime>
+#include <fstream>
 #include "scripted_core.hpp"
 
 namespace scripted::ui {
@@ -12,6 +19,12 @@ namespace scripted::ui {
 // Row to display
 struct Row { long long reg{}, addr{}; std::string val; };
 
+// Row order requested by the view; None = register/address (map) order
+enum class SortColumn { None, Reg, Addr, Raw, Resolved };
+
+// Resolved text of one cell of the current bank (lazy "Resolved" column)
+struct ResolvedCell { long long reg{}, addr{}; std::string text; };
+
 struct ViewModel {
     std::optional<long long> current;
     std::vector<Row> rows;         // full set
@@ -20,6 +33,95 @@ struct ViewModel {
     bool dirty=false;
 };
 
+// ───────── Session log ─────────
+enum class LogLevel : unsigned char { Debug, Info, Warn, Error };
+
+// Fixed-size so a slot can be copied out while another thread may reuse it.
+struct LogEntry {
+    unsigned long long seq = 0;   // 1-based, monotonically increasing
+    long long msSinceEpoch = 0;
+    LogLevel level = LogLevel::Info;
+    unsigned job = 0;             // 0 = not tied to a background job
+    std::array<char, 232> text{}; // NUL-terminated, truncated
+
+    std::string format() const {
+        std::time_t t = std::time_t(msSinceEpoch / 1000);
+        std::tm tm{};
+#if defined(_WIN32)
+        localtime_s(&tm, &t);
+#else
+        localtime_r(&t, &tm);
+#endif
+        char stamp[32];
+        std::snprintf(stamp, sizeof stamp, "%02d:%02d:%02d.%03d", tm.tm_hour, tm.tm_min, tm.tm_sec, int(msSinceEpoch % 1000));
+        static const char* names[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+        std::string s = std::string("[") + stamp + "] " + names[int(level)];
+        if (job) s += " #" + std::to_string(job);
+        return s + " " + text.data();
+    }
+};
+
+// Bounded lock-free log: append() from any thread claims a sequence number
+// and publishes the slot seqlock-style; readers copy a slot and keep it only
+// if its version did not move underneath them. Oldest entries are overwritten.
+class LogRing {
+public:
+    static constexpr size_t kCapacity = 1u << 14;
+
+    unsigned long long append(LogLevel level, unsigned job, std::string_view msg){
+        const unsigned long long n = next.fetch_add(1, std::memory_order_relaxed) + 1;
+        Slot& s = slots[(n - 1) & (kCapacity - 1)];
+        s.version.store(2*n - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.entry.seq = n;
+        s.entry.msSinceEpoch = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        s.entry.level = level;
+        s.entry.job = job;
+        const size_t len = std::min(msg.size(), s.entry.text.size() - 1);
+        std::memcpy(s.entry.text.data(), msg.data(), len);
+        s.entry.text[len] = '\0';
+        s.version.store(2*n, std::memory_order_release);
+        return n;
+    }
+
+    // Newest claimed sequence number (0 when empty) and oldest still retained.
+    unsigned long long last() const { return next.load(std::memory_order_acquire); }
+    unsigned long long first() const {
+        auto l = last();
+        return l > kCapacity ? l - kCapacity + 1 : 1;
+    }
+
+    // False if seq was overwritten or is still being written.
+    bool read(unsigned long long seq, LogEntry& out) const {
+        if (seq == 0) return false;
+        const Slot& s = slots[(seq - 1) & (kCapacity - 1)];
+        const auto v1 = s.version.load(std::memory_order_acquire);
+        if (v1 != 2*seq) return false;
+        std::memcpy(&out, &s.entry, sizeof out);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return s.version.load(std::memory_order_relaxed) == v1;
+    }
+
+    bool dumpTo(const std::filesystem::path& path, std::string& err) const {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out){ err = "Cannot open " + path.string(); return false; }
+        LogEntry e;
+        for (auto seq = first(), l = last(); seq <= l; ++seq)
+            if (read(seq, e)) out << e.format() << "\n";
+        if (!out){ err = "Write failed: " + path.string(); return false; }
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<unsigned long long> version{0}; // 2n-1 while writing n, 2n when published
+        LogEntry entry;
+    };
+    std::atomic<unsigned long long> next{0};
+    std::unique_ptr<Slot[]> slots{new Slot[kCapacity]};
+};
+
 // Interface that any GUI must implement
 struct IView {
     virtual ~IView() = default;
@@ -29,11 +131,28 @@ struct IView {
     virtual void showRows(const std::vector<Row>& rows) = 0;
     virtual void showCurrent(const std::optional<long long>& id) = 0;
     virtual void showBankList(const std::vector<std::pair<long long,std::string>>& banks) = 0;
+    // Incremental alternative to showBankList: banks added or retitled and
+    // banks gone since the previous call. Return false to get the full list.
+    virtual bool showBankDelta(const std::vector<std::pair<long long,std::string>>& /*upserts*/,
+                               const std::vector<long long>& /*removed*/) { return false; }
     virtual void setBusy(bool on) = 0;
 
     // Thread marshaling (Presenter can call this to run on UI thread)
     virtual void postToUi(std::function<void()> fn) = 0;
 
+    // Session log owned by the Presenter. attachLog is called once; logChanged
+    // may come from any thread after entries were appended. Views that render
+    // the ring themselves override these; others rely on showStatus.
+    virtual void attachLog(LogRing& /*log*/) {}
+    virtual void logChanged() {}
+
+    // Answers to onResolveCells (UI thread). Results for a bank that is no
+    // longer current, or from before an edit, are never delivered.
+    virtual void showResolved(const std::vector<ResolvedCell>& /*cells*/) {}
+    // Cells asked for that will not be answered because a newer
+    // onResolveCells replaced them (UI thread). Ask again if still visible.
+    virtual void dropResolved(const std::vector<std::pair<long long,long long>>& /*cells*/) {}
+
     // Wiring: the View fires these when the user acts (the Presenter subscribes)
     std::function<void(const std::string&)> onSwitch;   // e.g. "x00001" (stem or filename)
     std::function<void()>                   onPreload;
@@ -43,6 +162,9 @@ struct IView {
     std::function<void(long long,long long,const std::string&)> onInsert; // reg,addr,val
     std::function<void(long long,long long)>                       onDelete;
     std::function<void(const std::string&)> onFilter;   // filter changed
+    std::function<void(const std::string&)> onDumpLog;  // write session log to path ("" = default)
+    std::function<void(const std::vector<std::pair<long long,long long>>&)> onResolveCells; // reg,addr of visible cells
+    std::function<void(SortColumn, bool)>   onSort;     // column, ascending
 };
 
 } // namespace scripted::ui
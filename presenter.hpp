@@ -1,6 +1,13 @@
 #pragma once
 #include "frontend_contract.hpp"
 #include <thread>
+#include <memory>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <tuple>
 
 namespace scripted::ui {
 
@@ -9,15 +16,76 @@ public:
     Presenter(IView& v, Paths P)
     : view(v), P(std::move(P)) {
         cfg = ::scripted::loadConfig(this->P);
+        view.attachLog(logRing);
         wire();
         preloadAll(cfg, ws);
         pushBanks();
-        view.showStatus("Ready. Loaded "+std::to_string(ws.banks.size())+" banks.");
+        startAutosave();
+        report("Ready. Loaded "+std::to_string(ws.banks.size())+" banks.");
+    }
+
+    ~Presenter(){
+        { std::lock_guard lk(autoMu); autoStop = true; }
+        autoCv.notify_all();
+        if (autoThread.joinable()) autoThread.join();
+        { std::lock_guard lk(cellMu); cellStop = true; }
+        cellCv.notify_all();
+        if (cellThread.joinable()) cellThread.join();
+        for (auto& j : jobs) j.thread.join();
     }
 
     // Expose for tests (optional)
     const Workspace& workspace() const { return ws; }
     const Config& config() const { return cfg; }
+    const LogRing& log() const { return logRing; }
+
+    // Order rows of the current bank by a column. The permutation is cached
+    // per (bank, revision, column) and reused until the bank changes.
+    void sortRows(SortColumn col, bool ascending){
+        auto lk = lockWs();
+        sortCol = col; sortAsc = ascending;
+        refreshRows();
+    }
+
+    // Bulk address edits on the current bank. Moves optionally rewrite every
+    // reference to the moved cells across the workspace.
+    void deleteRange(long long reg, long long from, long long to){
+        auto lk = lockWs();
+        if (!current){ report("No current context", LogLevel::Warn); return; }
+        size_t n = eraseRange(ws.banks[*current], reg, from, to);
+        if (n) { edited(*current); refreshRows(); }
+        report("Deleted "+std::to_string(n)+" cells.");
+    }
+
+    void moveRange(long long reg, long long from, long long to,
+                   long long dstReg, long long dstFrom, bool rewriteRefs){
+        auto lk = lockWs();
+        if (!current){ report("No current context", LogLevel::Warn); return; }
+        std::vector<CellMove> moved; std::string err;
+        if (!::scripted::moveRange(ws.banks[*current], reg, from, to, dstReg, dstFrom, moved, err)){
+            report("Move refused: "+err, LogLevel::Warn); return;
+        }
+        std::set<long long> touched, pending; // pending: unsaved edits of their own
+        for (auto& [id, b] : ws.banks) if (id != *current && isDirty(id)) pending.insert(id);
+        size_t refs = rewriteRefs ? rewriteMovedRefs(cfg, ws, *current, moved, &touched) : 0;
+        if (!moved.empty()) { edited(*current); refreshRows(); }
+        report("Moved "+std::to_string(moved.size())+" cells"+
+               (rewriteRefs ? ", rewrote "+std::to_string(refs)+" references." : "."));
+        if (!rewriteRefs) return;
+        pushBanks(); // rewriting loads every bank under files/
+        // Save the rewrites now, but never write a bank's other edits unasked.
+        std::string unsaved;
+        for (long long id : touched){
+            if (id == *current) continue;
+            if (!pending.count(id)) { saveBank(id, "Rewrote references in"); continue; }
+            unsaved += (unsaved.empty()? "" : ", ") + (cfg.prefix + toBaseN(id, cfg.base, cfg.widthBank));
+        }
+        if (!unsaved.empty()) report("Not saved (has unsaved edits): "+unsaved, LogLevel::Warn);
+    }
+
+    void shiftRange(long long reg, long long from, long long delta, bool rewriteRefs){
+        moveRange(reg, from, std::numeric_limits<long long>::max(), reg, from + delta, rewriteRefs);
+    }
 
 private:
     IView& view;
@@ -25,51 +93,381 @@ private:
     Config cfg;
     Workspace ws;
     std::optional<long long> current;
-    bool dirty=false;
     std::atomic<bool> busy{false};
 
+    // Guards ws against the resolved-column worker. Taken by every UI-thread
+    // entry point (view callbacks, posted completions) and by the worker
+    // around each single-cell resolve.
+    std::mutex wsMu;
+    std::unique_lock<std::mutex> lockWs(){ return std::unique_lock(wsMu); }
+
+    // Save, resolve and export workers (UI thread only). Finished ones are
+    // joined when the next starts; the rest are joined on destruction.
+    struct Job { std::thread thread; std::shared_ptr<std::atomic<bool>> done; };
+    std::vector<Job> jobs;
+
+    template<class F> void spawn(F&& f){
+        std::erase_if(jobs, [](Job& j){ if (!*j.done) return false; j.thread.join(); return true; });
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        jobs.push_back({std::thread([f=std::forward<F>(f), done]() mutable { f(); *done = true; }), done});
+    }
+
+    // Session history; status lines and worker progress land here first.
+    LogRing logRing;
+    std::atomic<unsigned> nextJob{1};
+
+    // UI thread: log + status bar.
+    void report(const std::string& s, LogLevel level = LogLevel::Info, unsigned job = 0){
+        logRing.append(level, job, s);
+        view.logChanged();
+        view.showStatus(s);
+    }
+    // Any thread: log only.
+    void trace(const std::string& s, unsigned job, LogLevel level = LogLevel::Info){
+        logRing.append(level, job, s);
+        view.logChanged();
+    }
+
+    // Save bookkeeping (UI thread only): revision last written per bank,
+    // banks with a write in flight, and banks edited+saved again meanwhile.
+    std::map<long long, unsigned long long> savedRev;
+    std::set<long long> saving;
+    std::set<long long> saveAgain;
+
+    bool isDirty(long long id) const {
+        auto it = savedRev.find(id);
+        return ws.revision(id) != (it==savedRev.end()? 0 : it->second);
+    }
+
+    // Autosave: edits only raise a flag; the worker then waits out the
+    // interval before asking the UI thread to flush, so a burst of edits
+    // costs one background write per dirty bank.
+    std::mutex autoMu;
+    std::condition_variable autoCv;
+    bool autoPending=false, autoStop=false;
+    std::thread autoThread;
+
+    void startAutosave(){
+        if (cfg.autosave <= 0) return;
+        autoThread = std::thread([this](){
+            std::unique_lock lk(autoMu);
+            while (true){
+                autoCv.wait(lk, [this]{ return autoPending || autoStop; });
+                if (autoCv.wait_for(lk, std::chrono::seconds(cfg.autosave), [this]{ return autoStop; })) return;
+                autoPending = false;
+                lk.unlock();
+                view.postToUi([this](){ auto lk = lockWs(); autosaveDirty(); });
+                lk.lock();
+            }
+        });
+    }
+
+    void edited(long long id){ ws.touch(id); afterEdit(); }
+    void edited(long long id, long long reg, long long addr){ ws.touchCell(id, reg, addr); afterEdit(); }
+    void afterEdit(){
+        invalidateResolved();
+        if (cfg.autosave <= 0) return;
+        { std::lock_guard lk(autoMu); autoPending = true; }
+        autoCv.notify_one();
+    }
+
+    void autosaveDirty(){
+        for (auto& [id, b] : ws.banks)
+            if (isDirty(id)) saveBank(id, "Autosaved");
+    }
+
     void wire(){
-        view.onPreload = [this](){ preload(); };
-        view.onSwitch  = [this](const std::string& name){ openOrSwitch(name); };
-        view.onSave    = [this](){ save(); };
-        view.onResolve = [this](){ resolveAsync(); };
-        view.onExport  = [this](){ exportAsync(); };
-        view.onInsert  = [this](long long r,long long a,const std::string& v){ insert(r,a,v); };
-        view.onDelete  = [this](long long r,long long a){ erase(r,a); };
-        view.onFilter  = [this](const std::string& f){ filter = f; refreshRows(); };
+        view.onPreload = [this](){ auto lk = lockWs(); preload(); };
+        view.onSwitch  = [this](const std::string& name){ auto lk = lockWs(); openOrSwitch(name); };
+        view.onSave    = [this](){ auto lk = lockWs(); save(); };
+        view.onResolve = [this](){ auto lk = lockWs(); resolveAsync(); };
+        view.onExport  = [this](){ auto lk = lockWs(); exportAsync(); };
+        view.onInsert  = [this](long long r,long long a,const std::string& v){ auto lk = lockWs(); insert(r,a,v); };
+        view.onDelete  = [this](long long r,long long a){ auto lk = lockWs(); erase(r,a); };
+        view.onFilter  = [this](const std::string& f){ auto lk = lockWs(); filter = f; refreshRows(); };
+        view.onDumpLog = [this](const std::string& path){ dumpLog(path); };
+        view.onResolveCells = [this](const std::vector<std::pair<long long,long long>>& cells){ requestResolved(cells); };
+        view.onSort    = [this](SortColumn c, bool asc){ sortRows(c, asc); };
+    }
+
+    // ───────── Lazy resolved values for the current bank ─────────
+    // The view asks only for cells it is about to paint. Hits are answered
+    // from resolvedCache; misses go to one worker that resolves a cell per
+    // workspace lock and posts results back in small batches. Any edit or
+    // reload bumps resolvedGen, dropping the cache and in-flight results.
+    using CellKey = std::pair<long long,long long>;
+    std::map<CellKey, std::string> resolvedCache; // for cacheBank @ cacheGen
+    std::optional<long long> cacheBank;
+    unsigned long long cacheGen = 0;
+    std::atomic<unsigned long long> resolvedGen{1};
+
+    std::mutex cellMu;
+    std::condition_variable cellCv;
+    std::deque<CellKey> cellQueue;   // replaced, not appended: only the latest viewport matters
+    long long cellBank = 0;
+    unsigned long long cellGen = 0;
+    bool cellStop = false;
+    std::thread cellThread;
+
+    void invalidateResolved(){ ++resolvedGen; }
+
+    void requestResolved(const std::vector<CellKey>& cells){
+        if (!current) return;
+        const auto gen = resolvedGen.load();
+        if (cacheBank != current || cacheGen != gen){ resolvedCache.clear(); cacheBank = current; cacheGen = gen; }
+        std::vector<ResolvedCell> hits;
+        std::deque<CellKey> misses;
+        for (auto& k : cells){
+            auto it = resolvedCache.find(k);
+            if (it != resolvedCache.end()) hits.push_back({k.first, k.second, it->second});
+            else misses.push_back(k);
+        }
+        if (!hits.empty()) view.showResolved(hits);
+        if (misses.empty()) return;
+        std::vector<CellKey> dropped; // still queued from the last viewport
+        {
+            std::lock_guard lk(cellMu);
+            if (cellBank == *current && cellGen == gen){
+                std::set<CellKey> keep(misses.begin(), misses.end());
+                for (auto& k : cellQueue) if (!keep.count(k)) dropped.push_back(k);
+            }
+            cellQueue = std::move(misses);
+            cellBank = *current; cellGen = gen;
+        }
+        if (!dropped.empty()) view.dropResolved(dropped);
+        if (!cellThread.joinable()) cellThread = std::thread([this](){ cellWorker(); });
+        cellCv.notify_one();
+    }
+
+    void cellWorker(){
+        std::vector<ResolvedCell> batch;
+        long long bank = 0; unsigned long long gen = 0;
+        auto flush = [&](){
+            if (batch.empty()) return;
+            view.postToUi([this, bank, gen, cells=std::move(batch)](){
+                if (gen != resolvedGen.load() || bank != current) return; // stale
+                if (cacheBank != bank || cacheGen != gen){ resolvedCache.clear(); cacheBank = bank; cacheGen = gen; }
+                for (auto& c : cells) resolvedCache[{c.reg, c.addr}] = c.text;
+                view.showResolved(cells);
+            });
+            batch.clear();
+        };
+        std::unique_lock lk(cellMu);
+        while (true){
+            if (cellQueue.empty()){ lk.unlock(); flush(); lk.lock(); }
+            cellCv.wait(lk, [this]{ return cellStop || !cellQueue.empty(); });
+            if (cellStop) return;
+            if (cellBank != bank || cellGen != gen){ lk.unlock(); flush(); lk.lock(); bank = cellBank; gen = cellGen; }
+            CellKey k = cellQueue.front(); cellQueue.pop_front();
+            lk.unlock();
+            if (gen == resolvedGen.load()){
+                auto wl = lockWs();
+                auto itB = ws.banks.find(bank);
+                if (itB != ws.banks.end()){
+                    auto itR = itB->second.regs.find(k.first);
+                    if (itR != itB->second.regs.end()){
+                        auto itA = itR->second.find(k.second);
+                        if (itA != itR->second.end()){
+                            Resolver R(cfg, ws);
+                            std::unordered_set<std::string> visited;
+                            batch.push_back({k.first, k.second, R.resolve(itA->second, bank, visited)});
+                        }
+                    }
+                }
+            }
+            if (batch.size() >= 32) flush();
+            lk.lock();
+        }
     }
 
     std::string filter;
 
+    void dumpLog(const std::string& pathIn){
+        fs::path path = pathIn.empty()? P.outdir / "session.log" : fs::path(pathIn);
+        std::string err;
+        if (!logRing.dumpTo(path, err)) report("Log dump failed: "+err, LogLevel::Error);
+        else report("Log written -> "+path.string());
+    }
+
     void preload(){
         preloadAll(cfg, ws);
+        invalidateResolved();
         pushBanks();
-        view.showStatus("Preloaded "+std::to_string(ws.banks.size())+" banks.");
+        report("Preloaded "+std::to_string(ws.banks.size())+" banks.");
         refreshRows();
     }
 
+    // Last bank list the view was given; pushBanks sends only the difference.
+    std::map<long long, std::string> pushedBanks;
+
     void pushBanks(){
-        std::vector<std::pair<long long,std::string>> list;
-        list.reserve(ws.banks.size());
-        for (auto& [id,b] : ws.banks) list.emplace_back(id, b.title);
-        view.showBankList(list);
+        std::vector<std::pair<long long,std::string>> upserts;
+        std::vector<long long> removed;
+        auto it = pushedBanks.begin();
+        for (auto& [id,b] : ws.banks){
+            while (it != pushedBanks.end() && it->first < id){ removed.push_back(it->first); ++it; }
+            if (it != pushedBanks.end() && it->first == id){
+                if (it->second != b.title) upserts.emplace_back(id, b.title);
+                ++it;
+            } else upserts.emplace_back(id, b.title);
+        }
+        for (; it != pushedBanks.end(); ++it) removed.push_back(it->first);
+
+        if (!upserts.empty() || !removed.empty()){
+            for (long long id : removed) pushedBanks.erase(id);
+            for (auto& [id,title] : upserts) pushedBanks[id] = title;
+            if (!view.showBankDelta(upserts, removed)){
+                std::vector<std::pair<long long,std::string>> list(pushedBanks.begin(), pushedBanks.end());
+                view.showBankList(list);
+            }
+        }
         view.showCurrent(current);
     }
 
     void openOrSwitch(const std::string& nameOrStem){
         std::string status;
         if (!::scripted::openCtx(cfg, ws, nameOrStem, status)){
-            view.showStatus(status);
+            report(status, LogLevel::Error);
             return;
         }
         std::string stem = nameOrStem;
         if (stem.size()>4 && stem.ends_with(".txt")) stem.resize(stem.size()-4);
         std::string token = (!stem.empty() && stem[0]==cfg.prefix)? stem.substr(1) : stem;
         long long id=0; parseIntBase(token, cfg.base, id);
-        current = id; dirty=false;
+        current = id; savedRev[id] = ws.revision(id);
+        invalidateResolved();
         pushBanks();
         refreshRows();
-        view.showStatus(status);
+        report(status);
+    }
+
+    // ───────── Sorting ─────────
+    SortColumn sortCol = SortColumn::None;
+    bool sortAsc = true;
+    struct SortCache {
+        long long bank = -1;
+        unsigned long long rev = 0, gen = 0;
+        SortColumn col = SortColumn::None;
+        bool asc = true;
+        std::vector<unsigned> perm; // display order over map-order rows
+    } sortCache;
+
+    // Resolved text of every cell of a bank, in map order, for sorting. Filled
+    // by a worker (see resolveForSort) so the UI thread never resolves a bank.
+    struct SortKeys {
+        long long bank = -1;
+        unsigned long long rev = 0, gen = 0;
+        std::vector<std::string> keys;
+    } sortKeys;
+    std::optional<std::tuple<long long, unsigned long long, unsigned long long>> sortJob; // in flight
+
+    // Permutation of `rows` (map order) for the current sort column and
+    // direction. Keys are computed once up front; ties keep map order in
+    // both directions. Until a bank's resolved keys arrive, sorting by the
+    // Resolved column shows map order.
+    const std::vector<unsigned>& sortPermutation(const std::vector<Row>& rows){
+        const long long bank = *current;
+        const auto rev = ws.revision(bank), gen = resolvedGen.load();
+        auto& c = sortCache;
+        if (c.bank == bank && c.rev == rev && c.col == sortCol && c.asc == sortAsc &&
+            (sortCol != SortColumn::Resolved || c.gen == gen) && c.perm.size() == rows.size())
+            return c.perm;
+
+        c = SortCache{bank, rev, gen, sortCol, sortAsc, {}};
+        c.perm.resize(rows.size());
+        for (unsigned i=0;i<(unsigned)rows.size();++i) c.perm[i] = i;
+        auto byKey = [asc = sortAsc](const auto& keys){
+            return [&keys, asc](unsigned a, unsigned b){
+                const bool before = asc? keys[a] < keys[b] : keys[b] < keys[a];
+                const bool after  = asc? keys[b] < keys[a] : keys[a] < keys[b];
+                return before || (!after && a < b);
+            };
+        };
+        switch (sortCol){
+        case SortColumn::None:
+            break;
+        case SortColumn::Reg: {
+            if (sortAsc) break; // map order is already (reg, addr)
+            std::vector<long long> keys(rows.size());
+            for (size_t i=0;i<rows.size();++i) keys[i] = rows[i].reg;
+            parallelSort(c.perm.begin(), c.perm.end(), byKey(keys));
+            break;
+        }
+        case SortColumn::Addr: {
+            std::vector<std::pair<long long,long long>> keys(rows.size());
+            for (size_t i=0;i<rows.size();++i) keys[i] = {rows[i].addr, rows[i].reg};
+            parallelSort(c.perm.begin(), c.perm.end(), byKey(keys));
+            break;
+        }
+        case SortColumn::Raw: {
+            std::vector<std::string_view> keys(rows.size());
+            for (size_t i=0;i<rows.size();++i) keys[i] = rows[i].val;
+            parallelSort(c.perm.begin(), c.perm.end(), byKey(keys));
+            break;
+        }
+        case SortColumn::Resolved: {
+            auto& k = sortKeys;
+            if (k.bank != bank || k.rev != rev || k.gen != gen || k.keys.size() != rows.size()){
+                resolveForSort(bank, rev, gen);
+                c.bank = -1; // map order for now; not cached
+                break;
+            }
+            parallelSort(c.perm.begin(), c.perm.end(), byKey(k.keys));
+            break;
+        }
+        }
+        return c.perm;
+    }
+
+    // Resolves every cell of the bank on a worker, then hands the keys to the
+    // UI thread and re-sorts. wsMu is held only to load every bank and take a
+    // snapshot (see snapshotWs); the resolve threads read the snapshot. Banks
+    // loaded on the way are pushed to the view.
+    void resolveForSort(long long bank, unsigned long long rev, unsigned long long gen){
+        if (sortJob == std::tuple(bank, rev, gen)) return;
+        sortJob = std::tuple(bank, rev, gen);
+        const unsigned job = nextJob++;
+        report("Resolving for sort...", LogLevel::Info, job);
+        spawn([this, bank, rev, gen, job](){
+            std::vector<CellKey> cells;
+            std::vector<const std::string*> vals;
+            std::vector<std::string> keys;
+            std::shared_ptr<Workspace> snap;
+            bool loaded = false;
+            {
+                auto lk = lockWs();
+                if (ws.revision(bank) == rev && gen == resolvedGen.load() && ws.banks.count(bank)){
+                    const auto before = ws.banks.size();
+                    preloadAll(cfg, ws); // so resolver threads only read the snapshot
+                    loaded = ws.banks.size() != before;
+                    snap = snapshotWs(bank);
+                }
+            }
+            if (snap){
+                for (auto& [rid, addrs] : snap->banks[bank].regs)
+                    for (auto& [aid, val] : addrs){ cells.push_back({rid, aid}); vals.push_back(&val); }
+                keys.resize(vals.size());
+                parallelFor(vals.size(), [&](size_t b, size_t e){
+                    Resolver R(cfg, *snap);
+                    R.autoload = false;
+                    for (size_t i=b;i<e;++i){
+                        std::unordered_set<std::string> visited;
+                        keys[i] = R.resolve(*vals[i], bank, visited);
+                    }
+                }, 256);
+            }
+            view.postToUi([this, bank, rev, gen, job, loaded, cells=std::move(cells), keys=std::move(keys)]() mutable {
+                auto lk = lockWs();
+                if (sortJob == std::tuple(bank, rev, gen)) sortJob.reset();
+                if (loaded) pushBanks();
+                if (bank != current || ws.revision(bank) != rev || gen != resolvedGen.load() || keys.size() != cells.size()) return; // stale
+                if (cacheBank != bank || cacheGen != gen){ resolvedCache.clear(); cacheBank = bank; cacheGen = gen; }
+                for (size_t i=0;i<cells.size();++i) resolvedCache[cells[i]] = keys[i];
+                sortKeys = SortKeys{bank, rev, gen, std::move(keys)};
+                trace("Sorted by resolved value", job, LogLevel::Debug);
+                if (sortCol == SortColumn::Resolved) refreshRows();
+            });
+        });
     }
 
     void refreshRows(){
@@ -79,6 +477,12 @@ private:
             for (auto& [rid, addrs] : b.regs)
                 for (auto& [aid, val] : addrs)
                     rows.push_back({rid, aid, val});
+            if (sortCol != SortColumn::None && (sortCol != SortColumn::Reg || !sortAsc)){
+                const auto& perm = sortPermutation(rows);
+                std::vector<Row> sorted; sorted.reserve(rows.size());
+                for (auto i : perm) sorted.push_back(std::move(rows[i]));
+                rows.swap(sorted);
+            }
             if (!filter.empty()){
                 auto f = filter; std::transform(f.begin(), f.end(), f.begin(), ::tolower);
                 std::vector<Row> out; out.reserve(rows.size());
@@ -99,73 +503,116 @@ private:
     }
 
     void insert(long long reg, long long addr, const std::string& val){
-        if (!current){ view.showStatus("No current context"); return; }
-        ws.banks[*current].regs[reg][addr] = val; dirty=true;
+        if (!current){ report("No current context", LogLevel::Warn); return; }
+        ws.banks[*current].regs[reg][addr] = val; edited(*current, reg, addr);
         refreshRows();
-        view.showStatus("Updated "+toBaseN(reg,cfg.base,cfg.widthReg)+"."+toBaseN(addr,cfg.base,cfg.widthAddr));
+        report("Updated "+toBaseN(reg,cfg.base,cfg.widthReg)+"."+toBaseN(addr,cfg.base,cfg.widthAddr));
     }
 
     void erase(long long reg, long long addr){
-        if (!current){ view.showStatus("No current context"); return; }
+        if (!current){ report("No current context", LogLevel::Warn); return; }
         auto& regs = ws.banks[*current].regs;
         auto itR = regs.find(reg);
         if (itR!=regs.end()){
-            if (itR->second.erase(addr)) { dirty=true; refreshRows(); view.showStatus("Deleted."); }
+            if (itR->second.erase(addr)) { edited(*current); refreshRows(); report("Deleted."); }
         }
     }
 
     void save(){
-        if (!current){ view.showStatus("No current context"); return; }
-        std::string err;
-        auto path = contextFileName(cfg, *current);
-        if (!saveContextFile(cfg, path, ws.banks[*current], err)){
-            view.showStatus("Save failed: "+err);
-            return;
+        if (!current){ report("No current context", LogLevel::Warn); return; }
+        saveBank(*current);
+    }
+
+    // Snapshot the bank on the UI thread (a plain copy, no formatting or I/O),
+    // then serialize and write it on a worker. Editing continues meanwhile;
+    // a save requested while one is in flight is queued behind it.
+    void saveBank(long long id, const char* verb = "Saved"){
+        if (saving.count(id)){ saveAgain.insert(id); report("Save queued..."); return; }
+        auto snap = std::make_shared<const Bank>(ws.banks[id]); // caller holds wsMu
+        auto rev  = ws.revision(id);
+        auto path = contextFileName(cfg, id);
+        saving.insert(id);
+        const unsigned job = nextJob++;
+        trace("Saving "+path.string(), job, LogLevel::Debug);
+        spawn([this,id,rev,path,snap,verb,job,c=cfg](){
+            std::string err;
+            bool ok = saveContextFile(c, path, *snap, err);
+            view.postToUi([this,id,rev,path,verb,job,ok,err](){
+                saving.erase(id);
+                if (ok && rev > savedRev[id]) savedRev[id] = rev;
+                if (ok) report(std::string(verb)+" "+path.string(), LogLevel::Info, job);
+                else    report("Save failed: "+err, LogLevel::Error, job);
+                if (saveAgain.erase(id)){ auto lk = lockWs(); saveBank(id, verb); }
+            });
+        });
+    }
+
+    // A private workspace for a worker to read without wsMu. Loaded banks are
+    // frozen once and shared (a bank too wide to freeze is copied), and the
+    // bank being resolved is copied so its title and cells can be walked.
+    // Banks it lacks the worker loads from files/ into its own copy.
+    // Caller holds wsMu.
+    std::shared_ptr<Workspace> snapshotWs(long long id){
+        auto snap = std::make_shared<Workspace>();
+        snap->image = ws.image;
+        snap->cacheDir = ws.cacheDir;
+        for (auto& [bid, b] : ws.banks){
+            if (!ws.frozen.count(bid)) ws.freeze(bid);
+            if (auto f = ws.frozen.find(bid); f != ws.frozen.end()) snap->frozen[bid] = f->second;
+            else snap->banks[bid] = b;
         }
-        dirty=false;
-        view.showStatus("Saved "+path.string());
+        if (auto it = ws.banks.find(id); it != ws.banks.end()) snap->banks[id] = it->second;
+        return snap;
     }
 
     void resolveAsync(){
-        if (!current){ view.showStatus("No current context"); return; }
-        if (busy.exchange(true)){ view.showStatus("Busy..."); return; }
+        if (!current){ report("No current context", LogLevel::Warn); return; }
+        if (busy.exchange(true)){ report("Busy...", LogLevel::Warn); return; }
         view.setBusy(true);
         auto id=*current;
-        std::thread([this,id](){
+        auto snap = snapshotWs(id); // caller holds wsMu
+        const unsigned job = nextJob++;
+        trace("Resolve started", job, LogLevel::Debug);
+        spawn([this,id,job,snap](){
             std::string path; bool ok=true;
             try {
-                auto txt = resolveBankToText(cfg, ws, id);
                 auto outp = outResolvedName(cfg, id);
-                std::ofstream out(outp, std::ios::binary); out<<txt;
-                path = outp.string();
+                std::string err;
+                ok = resolveBankToFile(cfg, *snap, id, outp, err);
+                path = ok? outp.string() : err;
             } catch(...) { ok=false; }
-            view.postToUi([this,ok,path](){
+            view.postToUi([this,ok,path,job](){
                 view.setBusy(false);
                 busy=false;
-                view.showStatus(ok? "Resolved -> "+path : "Resolve failed.");
+                if (ok) report("Resolved -> "+path, LogLevel::Info, job);
+                else    report("Resolve failed: "+path, LogLevel::Error, job);
             });
-        }).detach();
+        });
     }
 
     void exportAsync(){
-        if (!current){ view.showStatus("No current context"); return; }
-        if (busy.exchange(true)){ view.showStatus("Busy..."); return; }
+        if (!current){ report("No current context", LogLevel::Warn); return; }
+        if (busy.exchange(true)){ report("Busy...", LogLevel::Warn); return; }
         view.setBusy(true);
         auto id=*current;
-        std::thread([this,id](){
+        auto snap = snapshotWs(id); // caller holds wsMu
+        const unsigned job = nextJob++;
+        trace("Export started", job, LogLevel::Debug);
+        spawn([this,id,job,snap](){
             std::string path; bool ok=true;
             try {
-                auto js = exportBankToJSON(cfg, ws, id);
+                std::string js = exportBankToJSON(cfg, *snap, id);
                 auto outp = outJsonName(cfg, id);
                 std::ofstream out(outp, std::ios::binary); out<<js;
                 path = outp.string();
             } catch(...) { ok=false; }
-            view.postToUi([this,ok,path](){
+            view.postToUi([this,ok,path,job](){
                 view.setBusy(false);
                 busy=false;
-                view.showStatus(ok? "Exported JSON -> "+path : "Export failed.");
+                if (ok) report("Exported JSON -> "+path, LogLevel::Info, job);
+                else    report("Export failed.", LogLevel::Error, job);
             });
-        }).detach();
+        });
     }
 };
 
@@ -24,20 +24,33 @@
 #include <QtWidgets/QStatusBar>
 #include <QtWidgets/QMenuBar>
 #include <QtWidgets/QFileDialog>
-#include <QtGui/QStandardItemModel>
+#include <QtWidgets/QListView>
+#include <QtWidgets/QCompleter>
+#include <QtWidgets/QHeaderView>
+#include <QtCore/QStringListModel>
+#include <QtWidgets/QScrollBar>
+#include <QtCore/QAbstractListModel>
+#include <QtGui/QColor>
+#include <QtCore/QAbstractTableModel>
 #include <QtGui/QClipboard>
 #include <QtCore/QMetaObject>
 #include <QtCore/QTimer>
 #include <QtCore/QFileInfo>
 #include <QtCore/QStringList>
 #include <QtGui/QKeyEvent>
-#include <QtCore/QTime>
 
 #include <string>
 #include <vector>
 #include <optional>
 #include <functional>
 #include <memory>
+#include <atomic>
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <cstdint>
 
 #include "scripted_core.hpp"
 #include "frontend_contract.hpp"
@@ -49,6 +62,334 @@ using namespace scripted::ui;
 static QString qFromStd(const std::string& s){ return QString::fromUtf8(s.c_str()); }
 static std::string qToStd(const QString& s){ QByteArray b = s.toUtf8(); return std::string(b.constData(), (size_t)b.size()); }
 
+// Lock-free multi-producer queue: producers push onto an intrusive stack,
+// the single consumer (UI thread) takes the whole stack at once and
+// restores arrival order.
+template<class T>
+class MpscQueue {
+    struct Node { T value; Node* next; };
+    std::atomic<Node*> head{nullptr};
+public:
+    MpscQueue() = default;
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+    ~MpscQueue(){ drain(); }
+
+    // Returns true when the queue was empty, i.e. the consumer needs a wake-up.
+    bool push(T v){
+        auto* n = new Node{std::move(v), head.load(std::memory_order_relaxed)};
+        while (!head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed)) {}
+        return n->next == nullptr;
+    }
+    std::vector<T> drain(){
+        Node* n = head.exchange(nullptr, std::memory_order_acquire);
+        std::vector<T> out;
+        while (n){ out.push_back(std::move(n->value)); Node* next = n->next; delete n; n = next; }
+        std::reverse(out.begin(), out.end());
+        return out;
+    }
+};
+
+// One pending UI update. Calls run in order; for Status/Rows/Log only the
+// latest of a frame is rendered.
+struct UiUpdate {
+    enum Kind { Call, Status, Rows, Log } kind;
+    std::function<void()> fn;
+    std::string text;
+    std::vector<Row> rows;
+};
+
+// Window over the Presenter's LogRing. The list view asks only for visible
+// rows, so formatting cost follows the viewport; sync() turns ring growth and
+// wrap-around into row insertions/removals instead of a reset.
+class LogModel final : public QAbstractListModel {
+public:
+    using QAbstractListModel::QAbstractListModel;
+
+    void attach(const LogRing* r){
+        beginResetModel();
+        ring = r; first = 1; rows = 0;
+        endResetModel();
+        sync();
+    }
+
+    void sync(){
+        if (!ring) return;
+        const auto newFirst = ring->first(), newLast = ring->last();
+        if (newFirst > first){
+            const int drop = (int)std::min<unsigned long long>(newFirst - first, (unsigned long long)rows);
+            if (drop > 0){ beginRemoveRows({}, 0, drop - 1); rows -= drop; endRemoveRows(); }
+            first = newFirst;
+        }
+        if (newLast + 1 > first + rows){
+            const int add = int(newLast + 1 - first - rows);
+            beginInsertRows({}, rows, rows + add - 1); rows += add; endInsertRows();
+        }
+    }
+
+    int rowCount(const QModelIndex& parent = {}) const override { return parent.isValid()? 0 : rows; }
+
+    QVariant data(const QModelIndex& idx, int role) const override {
+        if (!ring || !idx.isValid()) return {};
+        LogEntry e;
+        if (!ring->read(first + (unsigned long long)idx.row(), e)) return {};
+        if (role == Qt::DisplayRole) return QString::fromUtf8(e.format().c_str());
+        if (role == Qt::ForegroundRole){
+            if (e.level == LogLevel::Error) return QColor(Qt::red);
+            if (e.level == LogLevel::Warn)  return QColor(Qt::darkYellow);
+            if (e.level == LogLevel::Debug) return QColor(Qt::gray);
+        }
+        return {};
+    }
+
+private:
+    const LogRing* ring{};
+    unsigned long long first = 1; // sequence number shown in row 0
+    int rows = 0;
+};
+
+// Table over the Presenter's rows. The "Resolved" column is lazy: data() for
+// a cell with no cached text marks it wanted, and the view forwards wanted
+// cells once per frame, so only rows that actually get painted are resolved.
+class RowModel final : public QAbstractTableModel {
+public:
+    enum Column { ColReg, ColAddr, ColRaw, ColResolved, ColCount };
+
+    RowModel(const Config& c, QObject* parent) : QAbstractTableModel(parent), cfg(c) {}
+
+    std::function<void()> onWanted; // fired when the wanted set becomes non-empty
+
+    void setRows(std::vector<Row> r){
+        beginResetModel();
+        rows = std::move(r);
+        rowOf.clear();
+        rowOf.reserve(rows.size());
+        for (int i=0;i<(int)rows.size();++i) rowOf[key(rows[i].reg, rows[i].addr)] = i;
+        resolved.clear(); wanted.clear(); requested.clear();
+        endResetModel();
+    }
+
+    void setResolved(const std::vector<ResolvedCell>& cells){
+        int lo = INT_MAX, hi = -1;
+        for (auto& c : cells){
+            auto k = key(c.reg, c.addr);
+            resolved[k] = qFromStd(c.text);
+            requested.erase(k);
+            if (auto it = rowOf.find(k); it != rowOf.end()){ lo = std::min(lo, it->second); hi = std::max(hi, it->second); }
+        }
+        if (hi >= 0) emit dataChanged(index(lo, ColResolved), index(hi, ColResolved));
+    }
+
+    // Unanswered requests the Presenter gave up on: forget them and repaint,
+    // so cells still on screen are wanted again.
+    void dropRequested(const std::vector<std::pair<long long,long long>>& cells){
+        int lo = INT_MAX, hi = -1;
+        for (auto& c : cells){
+            auto k = key(c.first, c.second);
+            if (!requested.erase(k)) continue;
+            if (auto it = rowOf.find(k); it != rowOf.end()){ lo = std::min(lo, it->second); hi = std::max(hi, it->second); }
+        }
+        if (hi >= 0) emit dataChanged(index(lo, ColResolved), index(hi, ColResolved));
+    }
+
+    std::vector<std::pair<long long,long long>> takeWanted(){
+        std::vector<std::pair<long long,long long>> out(wanted.begin(), wanted.end());
+        requested.insert(wanted.begin(), wanted.end());
+        wanted.clear();
+        return out;
+    }
+
+    int rowCount(const QModelIndex& parent = {}) const override { return parent.isValid()? 0 : (int)rows.size(); }
+    int columnCount(const QModelIndex& parent = {}) const override { return parent.isValid()? 0 : ColCount; }
+
+    QVariant headerData(int section, Qt::Orientation o, int role) const override {
+        if (o != Qt::Horizontal || role != Qt::DisplayRole) return QAbstractTableModel::headerData(section, o, role);
+        switch (section){
+        case ColReg:      return QString("Reg");
+        case ColAddr:     return QString("Addr");
+        case ColRaw:      return QString("Value (raw)");
+        case ColResolved: return QString("Resolved");
+        }
+        return {};
+    }
+
+    QVariant data(const QModelIndex& idx, int role) const override {
+        if (!idx.isValid() || idx.row() >= (int)rows.size()) return {};
+        if (role != Qt::DisplayRole) return {};
+        const Row& r = rows[idx.row()];
+        switch (idx.column()){
+        case ColReg:  return qFromStd(toBaseN(r.reg,  cfg.base, cfg.widthReg));
+        case ColAddr: return qFromStd(toBaseN(r.addr, cfg.base, cfg.widthAddr));
+        case ColRaw:  return qFromStd(r.val);
+        case ColResolved: {
+            auto k = key(r.reg, r.addr);
+            if (auto it = resolved.find(k); it != resolved.end()) return it->second;
+            if (!requested.count(k) && wanted.insert(k).second && wanted.size() == 1 && onWanted) onWanted();
+            return QString("…");
+        }
+        }
+        return {};
+    }
+
+private:
+    using Key = std::pair<long long,long long>;
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return std::hash<unsigned long long>{}((unsigned long long)k.first * 1000003ULL ^ (unsigned long long)k.second);
+        }
+    };
+    static Key key(long long reg, long long addr){ return {reg, addr}; }
+
+    const Config& cfg;
+    std::vector<Row> rows;
+    std::unordered_map<Key, int, KeyHash> rowOf;
+    std::unordered_map<Key, QString, KeyHash> resolved;
+    mutable std::unordered_set<Key, KeyHash> wanted;    // seen while painting, not yet sent
+    std::unordered_set<Key, KeyHash> requested;         // sent, answer pending
+};
+
+// Bank list behind the switcher combo, kept sorted by id and patched from
+// Presenter deltas (row inserts/removals) rather than rebuilt.
+class BankListModel final : public QAbstractListModel {
+public:
+    using Entry = std::pair<long long,std::string>;
+
+    BankListModel(const Config& c, QObject* parent) : QAbstractListModel(parent), cfg(c) {}
+
+    void reset(std::vector<Entry> all){
+        beginResetModel();
+        banks = std::move(all);
+        std::sort(banks.begin(), banks.end());
+        endResetModel();
+    }
+
+    void apply(const std::vector<Entry>& upserts, const std::vector<long long>& removed){
+        for (long long id : removed){
+            auto it = find(id);
+            if (it == banks.end() || it->first != id) continue;
+            const int row = int(it - banks.begin());
+            beginRemoveRows({}, row, row); banks.erase(it); endRemoveRows();
+        }
+        if (upserts.size() > 64){ // bulk (first push, preload): one merge beats many inserts
+            std::map<long long,std::string> merged(banks.begin(), banks.end());
+            for (auto& [id,title] : upserts) merged[id] = title;
+            reset(std::vector<Entry>(merged.begin(), merged.end()));
+            return;
+        }
+        for (auto& [id,title] : upserts){
+            auto it = find(id);
+            const int row = int(it - banks.begin());
+            if (it != banks.end() && it->first == id){
+                it->second = title;
+                emit dataChanged(index(row,0), index(row,0));
+            } else {
+                beginInsertRows({}, row, row); banks.insert(it, {id, title}); endInsertRows();
+            }
+        }
+    }
+
+    const std::vector<Entry>& entries() const { return banks; }
+
+    QString label(const Entry& e) const {
+        return qFromStd(std::string(1, cfg.prefix) + toBaseN(e.first, cfg.base, cfg.widthBank) + "  (" + e.second + ")");
+    }
+
+    int rowCount(const QModelIndex& parent = {}) const override { return parent.isValid()? 0 : (int)banks.size(); }
+
+    QVariant data(const QModelIndex& idx, int role) const override {
+        if (!idx.isValid() || idx.row() >= (int)banks.size()) return {};
+        if (role == Qt::DisplayRole || role == Qt::EditRole) return label(banks[idx.row()]);
+        return {};
+    }
+
+private:
+    std::vector<Entry>::iterator find(long long id){
+        return std::lower_bound(banks.begin(), banks.end(), id,
+                                [](const Entry& e, long long v){ return e.first < v; });
+    }
+    const Config& cfg;
+    std::vector<Entry> banks;
+};
+
+// Search index for the combo's completer: sorted display keys answer prefix
+// queries, lowercase trigram postings over "key title" answer substring
+// queries. Both are patched per bank alongside BankListModel.
+class BankIndex {
+public:
+    void clear(){ keys.clear(); texts.clear(); grams.clear(); }
+
+    void upsert(long long id, const std::string& key, const std::string& title){
+        remove(id);
+        std::string text = lower(key + " " + title);
+        keys.emplace(lower(key), id);
+        forEachGram(text, [&](uint32_t g){
+            auto& ids = grams[g];
+            auto it = std::lower_bound(ids.begin(), ids.end(), id);
+            if (it == ids.end() || *it != id) ids.insert(it, id);
+        });
+        texts.emplace(id, std::move(text));
+    }
+
+    void remove(long long id){
+        auto t = texts.find(id);
+        if (t == texts.end()) return;
+        keys.erase(t->second.substr(0, t->second.find(' ')));
+        forEachGram(t->second, [&](uint32_t g){
+            auto p = grams.find(g);
+            if (p == grams.end()) return;
+            auto it = std::lower_bound(p->second.begin(), p->second.end(), id);
+            if (it != p->second.end() && *it == id) p->second.erase(it);
+            if (p->second.empty()) grams.erase(p);
+        });
+        texts.erase(t);
+    }
+
+    // Key-prefix matches first, then other substring matches, by id.
+    std::vector<long long> query(const std::string& raw, size_t limit) const {
+        const std::string q = lower(raw);
+        std::vector<long long> out;
+        if (q.empty()) return out;
+        std::unordered_set<long long> seen;
+        for (auto it = keys.lower_bound(q); it != keys.end() && it->first.compare(0, q.size(), q) == 0; ++it){
+            out.push_back(it->second); seen.insert(it->second);
+            if (out.size() >= limit) return out;
+        }
+        if (q.size() < 3) return out;
+        // Walk the rarest trigram's postings and verify each candidate.
+        const std::vector<long long>* best = nullptr;
+        bool missing = false;
+        forEachGram(q, [&](uint32_t g){
+            auto p = grams.find(g);
+            if (p == grams.end()){ missing = true; return; }
+            if (!best || p->second.size() < best->size()) best = &p->second;
+        });
+        if (missing || !best) return out;
+        for (long long id : *best){
+            if (seen.count(id)) continue;
+            auto t = texts.find(id);
+            if (t != texts.end() && t->second.find(q) != std::string::npos){
+                out.push_back(id);
+                if (out.size() >= limit) break;
+            }
+        }
+        return out;
+    }
+
+private:
+    static std::string lower(std::string s){
+        for (auto& c : s) c = (char)std::tolower((unsigned char)c);
+        return s;
+    }
+    template<class F> static void forEachGram(const std::string& s, F&& f){
+        for (size_t i=0; i+3<=s.size(); ++i)
+            f((uint32_t((unsigned char)s[i]) << 16) | (uint32_t((unsigned char)s[i+1]) << 8) | (unsigned char)s[i+2]);
+    }
+
+    std::map<std::string, long long> keys;            // lowercase display key -> id
+    std::unordered_map<long long, std::string> texts; // id -> lowercase "key title"
+    std::unordered_map<uint32_t, std::vector<long long>> grams; // trigram -> sorted ids
+};
+
 class QtView final : public QMainWindow, public IView {
     //Q_OBJECT
 public:
@@ -65,33 +406,37 @@ public:
         buildMenus();
         buildUi();
         statusBar()->showMessage("Ready.");
+
+        pump = new QTimer(this);
+        pump->setSingleShot(true);
+        pump->setInterval(kFrameMs);
+        connect(pump, &QTimer::timeout, this, [this]{ drainUpdates(); });
     }
 
     // ───────── IView (Presenter -> View) ─────────
+    // Status and rows go through the update pump, so they are safe from any
+    // thread and a burst of them renders once per frame.
     void showStatus(const std::string& s) override {
-        statusBar()->showMessage(qFromStd(s), 5000);
-        appendLog(s);
+        enqueue({UiUpdate::Status, {}, s, {}});
     }
 
     void showRows(const std::vector<Row>& rowsIn) override {
-        rows = rowsIn;
-        model->setRowCount(0);
-        model->setColumnCount(3);
-        if (model->columnCount() == 3) {
-            model->setHeaderData(0, Qt::Horizontal, "Reg");
-            model->setHeaderData(1, Qt::Horizontal, "Addr");
-            model->setHeaderData(2, Qt::Horizontal, "Value (raw)");
-        }
-        model->setRowCount((int)rows.size());
-        for (int i=0;i<(int)rows.size();++i){
-            const Row& r = rows[i];
-            model->setData(model->index(i,0), qFromStd(toBaseN(r.reg,  cfg.base, cfg.widthReg)));
-            model->setData(model->index(i,1), qFromStd(toBaseN(r.addr, cfg.base, cfg.widthAddr)));
-            model->setData(model->index(i,2), qFromStd(r.val));
-        }
+        enqueue({UiUpdate::Rows, {}, {}, rowsIn});
+    }
+
+    void renderRows(std::vector<Row> rowsIn){
+        model->setRows(std::move(rowsIn));
         table->resizeColumnsToContents();
     }
 
+    void showResolved(const std::vector<ResolvedCell>& cells) override {
+        model->setResolved(cells);
+    }
+
+    void dropResolved(const std::vector<std::pair<long long,long long>>& cells) override {
+        model->dropRequested(cells);
+    }
+
     void showCurrent(const std::optional<long long>& id) override {
         current = id;
         if (current){
@@ -102,14 +447,23 @@ public:
     }
 
     void showBankList(const std::vector<std::pair<long long,std::string>>& banks) override {
-        bankList = banks;
+        bankIndex.clear();
+        for (auto& [id, title] : banks) bankIndex.upsert(id, displayKey(id), title);
         combo->blockSignals(true);
-        combo->clear();
-        for (auto& [id, title] : bankList){
-            combo->addItem(qFromStd(displayKey(id) + "  (" + title + ")"));
-        }
+        bankModel->reset(banks);
+        if (current) combo->setCurrentText(qFromStd(displayKey(*current)));
+        combo->blockSignals(false);
+    }
+
+    bool showBankDelta(const std::vector<std::pair<long long,std::string>>& upserts,
+                       const std::vector<long long>& removed) override {
+        for (long long id : removed) bankIndex.remove(id);
+        for (auto& [id, title] : upserts) bankIndex.upsert(id, displayKey(id), title);
+        combo->blockSignals(true);
+        bankModel->apply(upserts, removed);
         if (current) combo->setCurrentText(qFromStd(displayKey(*current)));
         combo->blockSignals(false);
+        return true;
     }
 
     void setBusy(bool on) override {
@@ -120,8 +474,16 @@ public:
     }
 
     void postToUi(std::function<void()> fn) override {
-        // Marshal to UI thread
-        QMetaObject::invokeMethod(this, [f=std::move(fn)](){ f(); }, Qt::QueuedConnection);
+        enqueue({UiUpdate::Call, std::move(fn), {}, {}});
+    }
+
+    void attachLog(LogRing& r) override {
+        logRing = &r;
+        logModel->attach(&r);
+    }
+
+    void logChanged() override {
+        enqueue({UiUpdate::Log, {}, {}, {}});
     }
 
     // Accelerator access not needed; Qt Actions handle them internally
@@ -140,6 +502,14 @@ private:
         actSave->setShortcut(QKeySequence::Save);
         connect(actSave, &QAction::triggered, this, [this]{ if (onSave) onSave(); });
 
+        auto actSaveLog = file->addAction("Save &log...");
+        connect(actSaveLog, &QAction::triggered, this, [this]{
+            const QString startPath = QString::fromStdString((P.outdir / "session.log").string());
+            const QString path = QFileDialog::getSaveFileName(this, "Save Log", startPath,
+                                  "Log files (*.log);;All files (*.*)");
+            if (!path.isEmpty() && onDumpLog) onDumpLog(qToStd(path));
+        });
+
         file->addSeparator();
         auto actExit = file->addAction("E&xit");
         connect(actExit, &QAction::triggered, this, &QWidget::close);
@@ -179,7 +549,7 @@ private:
         auto help = mbar->addMenu("&Help");
         auto actAbout = help->addAction("&About");
         connect(actAbout, &QAction::triggered, this, [this]{
-            appendLog("scripted-gui (Qt View)\n— Presenter + Core\n— Background resolve/export\n— Filter & shortcuts");
+            note("scripted-gui (Qt View) — Presenter + Core — Background resolve/export — Filter & shortcuts");
         });
     }
 
@@ -192,6 +562,16 @@ private:
         combo = new QComboBox(central);
         combo->setEditable(true);
         combo->setInsertPolicy(QComboBox::NoInsert);
+        bankModel = new BankListModel(cfg, combo);
+        combo->setModel(bankModel);
+        if (auto* lv = qobject_cast<QListView*>(combo->view())) lv->setUniformItemSizes(true);
+        // Completion is answered from BankIndex, not by the completer scanning the model.
+        completerModel = new QStringListModel(combo);
+        completer = new QCompleter(combo);
+        completer->setModel(completerModel);
+        completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+        completer->setMaxVisibleItems(20);
+        combo->setCompleter(completer);
         topRow->addWidget(combo, /*stretch*/0);
 
         btnSwitch  = new QPushButton("Switch", central);
@@ -216,8 +596,25 @@ private:
         // Middle: table (left) + value editor (right)
         auto midRow = new QHBoxLayout();
         table = new QTableView(central);
-        model = new QStandardItemModel(table);
+        model = new RowModel(cfg, table);
+        model->onWanted = [this]{
+            postToUi([this]{
+                auto cells = model->takeWanted();
+                if (!cells.empty() && onResolveCells) onResolveCells(cells);
+            });
+        };
         table->setModel(model);
+        // Header clicks ask the Presenter for an order; the model just shows it.
+        auto* header = table->horizontalHeader();
+        header->setSectionsClickable(true);
+        header->setSortIndicatorShown(true);
+        header->setSortIndicator(-1, Qt::AscendingOrder);
+        connect(header, &QHeaderView::sortIndicatorChanged, this, [this](int section, Qt::SortOrder order){
+            static const SortColumn cols[RowModel::ColCount] = {
+                SortColumn::Reg, SortColumn::Addr, SortColumn::Raw, SortColumn::Resolved };
+            const SortColumn col = (section >= 0 && section < RowModel::ColCount)? cols[section] : SortColumn::None;
+            if (onSort) onSort(col, order == Qt::AscendingOrder);
+        });
         table->setSelectionBehavior(QAbstractItemView::SelectRows);
         table->setSelectionMode(QAbstractItemView::SingleSelection);
         table->setEditTriggers(QAbstractItemView::NoEditTriggers);
@@ -253,10 +650,13 @@ private:
         progress->setRange(0,1);
         root->addWidget(progress);
 
-        log = new QPlainTextEdit(central);
-        log->setReadOnly(true);
-        log->setMaximumBlockCount(2000);
-        root->addWidget(log);
+        logView = new QListView(central);
+        logModel = new LogModel(logView);
+        logView->setModel(logModel);
+        logView->setUniformItemSizes(true);
+        logView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+        logView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+        root->addWidget(logView);
 
         setCentralWidget(central);
 
@@ -265,6 +665,20 @@ private:
         connect(combo, &QComboBox::activated, this, [this](int){
             switchFromCombo();
         });
+        connect(combo->lineEdit(), &QLineEdit::textEdited, this, [this](const QString& text){
+            QStringList matches;
+            for (long long id : bankIndex.query(qToStd(text.trimmed()), kCompletions)){
+                auto& all = bankModel->entries();
+                auto it = std::lower_bound(all.begin(), all.end(), id,
+                                           [](const BankListModel::Entry& e, long long v){ return e.first < v; });
+                if (it != all.end() && it->first == id) matches << bankModel->label(*it);
+            }
+            completerModel->setStringList(matches);
+            if (!matches.isEmpty()) completer->complete();
+        });
+        connect(completer, QOverload<const QString&>::of(&QCompleter::activated), this, [this](const QString&){
+            switchFromCombo();
+        });
         connect(btnPreload, &QPushButton::clicked, this, [this]{ if (onPreload) onPreload(); });
         connect(btnOpen,    &QPushButton::clicked, this, [this]{
             // "Open/Reload" behaves like Open dialog (choose) or reload current if empty
@@ -306,15 +720,41 @@ private:
         return QMainWindow::eventFilter(obj, ev);
     }
 
-    // ───────── helpers ─────────
-    void appendLog(const std::string& s){
-        log->appendPlainText("[" + QString::fromUtf8(nowStr().c_str()) + "] " + qFromStd(s));
+    // ───────── update pump ─────────
+    void enqueue(UiUpdate u){
+        // Only the push that finds the queue empty schedules a drain, so at
+        // most one queued invocation is in flight per frame.
+        if (updates.push(std::move(u)))
+            QMetaObject::invokeMethod(this, [this]{ if (!pump->isActive()) pump->start(); }, Qt::QueuedConnection);
     }
 
-    static std::string nowStr(){
-        // simple HH:MM:SS
-        QTime t = QTime::currentTime();
-        return qToStd(t.toString("HH:mm:ss"));
+    void drainUpdates(){
+        std::optional<std::string> status;
+        std::optional<std::vector<Row>> latestRows;
+        bool logDirty = false;
+        for (auto& u : updates.drain()){
+            switch (u.kind){
+            case UiUpdate::Call:   u.fn(); break;
+            case UiUpdate::Status: status = std::move(u.text); break;
+            case UiUpdate::Rows:   latestRows = std::move(u.rows); break;
+            case UiUpdate::Log:    logDirty = true; break;
+            }
+        }
+        if (logDirty){
+            auto* bar = logView->verticalScrollBar();
+            const bool follow = bar->value() == bar->maximum();
+            logModel->sync();
+            if (follow) logView->scrollToBottom();
+        }
+        if (status) statusBar()->showMessage(qFromStd(*status), 5000);
+        if (latestRows) renderRows(std::move(*latestRows));
+    }
+
+    // ───────── helpers ─────────
+    // View-originated messages share the Presenter's session log.
+    void note(const std::string& s){
+        if (logRing){ logRing->append(LogLevel::Info, 0, s); logChanged(); }
+        showStatus(s);
     }
 
     void openDialog(){
@@ -328,9 +768,10 @@ private:
     }
 
     void switchFromCombo(){
-        const auto entry = combo->currentText().trimmed();
-        if (entry.isEmpty()){ showStatus("Enter a context (e.g., x00001)"); return; }
-        if (onSwitch) onSwitch(qToStd(entry));
+        // Entries read "x00001  (title)"; only the key goes to the Presenter.
+        const std::string entry = qToStd(combo->currentText().trimmed());
+        if (entry.empty()){ note("Enter a context (e.g., x00001)"); return; }
+        if (onSwitch) onSwitch(entry.substr(0, entry.find_first_of(" \t")));
     }
 
     void insertFromEditors(){
@@ -339,8 +780,8 @@ private:
         QString addrS = editAddr->text().trimmed();
         if (regS.isEmpty()) regS = "1";
         long long r=1, a=0;
-        if (!parseIntBase(qToStd(regS),  cfg.base, r)){ showStatus("Bad register"); return; }
-        if (!parseIntBase(qToStd(addrS), cfg.base, a)){ showStatus("Bad address");  return; }
+        if (!parseIntBase(qToStd(regS),  cfg.base, r)){ note("Bad register"); return; }
+        if (!parseIntBase(qToStd(addrS), cfg.base, a)){ note("Bad address");  return; }
         onInsert(r, a, qToStd(editValue->toPlainText()));
     }
 
@@ -363,7 +804,7 @@ private:
                       model->index(row,1).data().toString() + "\t" +
                       model->index(row,2).data().toString() + "\n";
         QApplication::clipboard()->setText(tsv);
-        showStatus("Copied selection to clipboard.");
+        note("Copied selection to clipboard.");
     }
 
     std::string displayKey(long long id) const {
@@ -377,20 +818,29 @@ private:
 
     // Widgets
     QComboBox* combo{};
+    BankListModel* bankModel{};
+    QCompleter* completer{};
+    QStringListModel* completerModel{};
+    BankIndex bankIndex;
+    static constexpr int kCompletions = 50;
     QPushButton *btnSwitch{}, *btnPreload{}, *btnOpen{}, *btnSave{}, *btnResolve{}, *btnExport{};
     QPushButton *btnInsert{}, *btnDelete{};   // <-- add these two
     QLineEdit *editFilter{}, *editReg{}, *editAddr{};
     QPlainTextEdit* editValue{};
     QTableView* table{};
-    QStandardItemModel* model{};
+    RowModel* model{};
     QProgressBar* progress{};
-    QPlainTextEdit* log{};
+    QListView* logView{};
+    LogModel* logModel{};
+    LogRing* logRing{};   // owned by the Presenter
 
+    // Batched Presenter -> View updates, drained once per frame
+    static constexpr int kFrameMs = 16;
+    MpscQueue<UiUpdate> updates;
+    QTimer* pump{};
 
     // View state
     std::optional<long long> current;
-    std::vector<std::pair<long long,std::string>> bankList;
-    std::vector<Row> rows;
 };
 
 // ───────── entry point (creates Presenter with the View) ─────────
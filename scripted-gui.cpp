@@ -508,6 +508,7 @@ struct App {
         if (!parseIntBase(trim(addrS), cfg.base, addrId)){ setStatus("Bad addr"); return; }
 
         ws.banks[*current].regs[regId][addrId] = valS; dirty=true;
+        ws.touchCell(*current, regId, addrId);
 
         bool found=false;
         for (auto& r : rows){ if (r.reg==regId && r.addr==addrId){ r.val = valS; found=true; break; } }
@@ -530,6 +531,7 @@ struct App {
             size_t n = itR->second.erase(r.addr);
             if (n>0){
                 dirty=true;
+                ws.touch(*current);
                 for (size_t i=0;i<rows.size();++i){
                     if (rows[i].reg==r.reg && rows[i].addr==r.addr){ rows.erase(rows.begin()+i); break; }
                 }
@@ -2,20 +2,113 @@
 // g++ -std=c++23 -O2 scripted.cpp -o scripted.exe
 #include "scripted_core.hpp"
 #include <iostream>
+#include <iomanip>
+#include <array>
+#include <chrono>
+#include <future>
+#include <condition_variable>
+#include <memory>
+#include <new>
+#include <set>
+#include <tuple>
+#include <utility>
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#else
+#include <malloc.h>
+#endif
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
 
 using namespace scripted;
 using std::string;
 
+// Allocation hooks for :stats and --bench --allocs. They only count while
+// allocTracking() is on; otherwise they cost one relaxed load. The nothrow
+// forms forward to these, so they are counted too.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // free() is the match for this malloc()
+#endif
+void* operator new(std::size_t n){
+    noteAlloc(n);
+    if (void* p = std::malloc(n? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n){ return ::operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// Over-aligned types (alignas beyond the default) come through these.
+void* operator new(std::size_t n, std::align_val_t al){
+    noteAlloc(n);
+    const std::size_t a = std::size_t(al);
+#if defined(_WIN32)
+    if (void* p = _aligned_malloc(n? n : 1, a)) return p;
+#else
+    if (void* p = std::aligned_alloc(a, (std::max<std::size_t>(n, 1) + a - 1) / a * a)) return p;
+#endif
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n, std::align_val_t al){ return ::operator new(n, al); }
+#if defined(_WIN32)
+void operator delete(void* p, std::align_val_t) noexcept { _aligned_free(p); }
+#else
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+#endif
+void operator delete[](void* p, std::align_val_t al) noexcept { ::operator delete(p, al); }
+void operator delete(void* p, std::size_t, std::align_val_t al) noexcept { ::operator delete(p, al); }
+void operator delete[](void* p, std::size_t, std::align_val_t al) noexcept { ::operator delete(p, al); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
 struct Editor {
     Paths P;
     Config cfg;
     Workspace ws;
     std::optional<long long> current;
-    bool dirty=false;
+    std::map<long long, unsigned long long> savedRev; // revision last written per bank
+
+    // Autosave ticks on its own thread, also while the prompt waits for input:
+    // at most once per cfg.autosave seconds it snapshots every dirty bank and
+    // writes them on a background task. Commands hold wsMu while they run.
+    std::chrono::steady_clock::time_point lastAutosave{};
+    std::future<std::vector<std::pair<long long,string>>> autosaveJob; // failures
+    std::mutex wsMu;
+    std::condition_variable autosaveCv;
+    bool stopping = false;
+
+    // Named what-if layers over ws. While one is active, cell edits land in
+    // it and views/resolves read through it; ws is left untouched.
+    std::map<string, Overlay> overlays;
+    string activeOverlay;
+    Bank layered; // current bank seen through the active overlay
 
     void loadConfig(){ cfg = ::scripted::loadConfig(P); }  // note the qualification
     void saveCfg(){ saveConfig(P, cfg); }
     bool ensureCurrent(){ if(!current){ std::cout<<"No current context. Use :open <ctx>\n"; return false;} return true; }
+    bool isDirty(long long id){ return ws.revision(id) != savedRev[id]; }
+    bool anyDirty(){ for (auto& [id,b] : ws.banks) if (isDirty(id)) return true; return false; }
+    Overlay* overlay(){ return activeOverlay.empty()? nullptr : &overlays[activeOverlay]; }
+    const Bank& curBank(){
+        if (!overlay()) return ws.banks[*current];
+        layered = overlaidBank(ws, *overlay(), *current);
+        return layered;
+    }
+    bool noOverlay(){
+        if (!overlay()) return true;
+        std::cout<<"Not available in overlay '"<<activeOverlay<<"'. Use :overlay commit or :overlay use base\n";
+        return false;
+    }
 
     void help(){
         std::cout <<
@@ -26,17 +119,40 @@ R"(Commands:
   :preload                       Load all banks in files/
   :ls                            List loaded contexts
   :show                          Print current buffer (header + addresses)
+  :show <reg>[.<from>[-<to>]]    Print one register, or an address window of it
+  :head [n] / :tail [n]          Print the first / last n cells (default 20)
+  :find <text...>                Print cells whose value contains text (first 50)
   :ins <addr> <value...>         Insert/replace in register 1
   :insr <reg> <addr> <value...>  Insert/replace into a specific register
   :del <addr>                    Delete from register 1
   :delr <reg> <addr>             Delete from a specific register
+  :delrange <reg> <from> <to>    Delete addresses from..to of a register
+  :moverange <reg> <from> <to> <dstReg> <dstFrom> [refs]
+                                 Move a range; 'refs' also rewrites references to it
+  :shift <reg> <from> <delta> [refs]
+                                 Move addresses >= from by delta (may be negative)
   :w                             Write current buffer to files/<ctx>.txt
-  :r <path>                      Read/merge a raw model snippet from a file
+  :r <path|glob> [policy]        Read/merge raw model snippets (policy: overwrite|keep|report)
+  :merge <ctx> [policy]          Merge another bank into the current one
   :resolve                       Write files/out/<ctx>.resolved.txt
   :export                        Write files/out/<ctx>.json
   :set prefix <char>
   :set base <n>
   :set widths bank=5 addr=4 reg=2
+  :set autosave <sec>            Background-save dirty banks at most every <sec>s (0=off)
+  :diff <ctxA> <ctxB> [resolved] Show cells added/removed/changed from A to B
+  :diffdir <dir> [resolved]      Diff loaded banks against context files in dir
+  :hotspots [n]                  Top n cells by fan-in/out, chain depth, resolved size
+  :freeze [ctx|all]              Read-optimise banks you are not editing (edits thaw)
+  :dedup [on|off]                Duplicate-value report; on = frozen banks share one intern pool
+  :cache [on|off|clear]          Resolved-value cache in files/.cache (hits/misses; on by default)
+  :stats [on|off|reset]          Allocation counts and bytes per operation (tracking is off by default)
+  :publish [path]                Write all banks as a shared image (default files/out/workspace.img)
+  :attach <path>                 Read unopened banks from a published image
+  :overlay [status]              List overlays and their edited cell counts
+  :overlay new <name>            Start a what-if layer over the loaded banks
+  :overlay use <name|base>       Switch layer; 'base' edits banks directly
+  :overlay commit|discard        Apply or drop the active layer
   :q                             Quit (prompts if dirty)
 )" << std::endl;
     }
@@ -45,28 +161,127 @@ R"(Commands:
         if (ws.banks.empty()) { std::cout<<"(no contexts)\n"; return; }
         for (auto& [id,b] : ws.banks){
             std::cout<<cfg.prefix<<toBaseN(id,cfg.base,cfg.widthBank)<<"  ("<<b.title<<")"
-                     <<(current && *current==id? " [current]":"")<<"\n";
+                     <<(current && *current==id? " [current]":"")<<(ws.frozen.count(id)? " [frozen]":"")<<"\n";
         }
     }
 
     void show(){
         if (!ensureCurrent()) return;
-        std::cout<<writeBankText(ws.banks[*current], cfg);
+        std::cout<<writeBankText(curBank(), cfg);
+    }
+
+    // Windowed views: seek into the (reg -> addr) maps instead of formatting
+    // the whole bank.
+    void printCell(long long reg, long long addr, const string& val){
+        std::cout<<toBaseN(reg,cfg.base,cfg.widthReg)<<"."<<toBaseN(addr,cfg.base,cfg.widthAddr)<<"\t"<<val<<"\n";
+    }
+
+    void showRange(const string& spec){
+        if (!ensureCurrent()) return;
+        long long reg=0, from=0, to=std::numeric_limits<long long>::max();
+        auto dot = spec.find('.');
+        if (!parseIntBase(spec.substr(0, dot), cfg.base, reg)){ std::cout<<"Bad register\n"; return; }
+        if (dot != string::npos){
+            string win = spec.substr(dot+1);
+            auto dash = win.find('-');
+            if (!parseIntBase(win.substr(0, dash), cfg.base, from)){ std::cout<<"Bad address\n"; return; }
+            to = from;
+            if (dash != string::npos && !parseIntBase(win.substr(dash+1), cfg.base, to)){ std::cout<<"Bad address\n"; return; }
+        }
+        auto& regs = curBank().regs;
+        auto itR = regs.find(reg);
+        if (itR==regs.end()){ std::cout<<"No such register.\n"; return; }
+        size_t n=0;
+        for (auto it = itR->second.lower_bound(from); it != itR->second.end() && it->first <= to; ++it, ++n)
+            printCell(reg, it->first, it->second);
+        std::cout<<"("<<n<<" cells)\n";
+    }
+
+    void head(size_t n){
+        if (!ensureCurrent()) return;
+        for (auto& [rid, addrs] : curBank().regs)
+            for (auto& [aid, val] : addrs){
+                if (n==0) return;
+                printCell(rid, aid, val); --n;
+            }
+    }
+
+    void tail(size_t n){
+        if (!ensureCurrent()) return;
+        std::vector<std::tuple<long long,long long,const string*>> last;
+        auto& regs = curBank().regs;
+        for (auto r = regs.rbegin(); r != regs.rend() && last.size() < n; ++r)
+            for (auto a = r->second.rbegin(); a != r->second.rend() && last.size() < n; ++a)
+                last.emplace_back(r->first, a->first, &a->second);
+        for (auto it = last.rbegin(); it != last.rend(); ++it)
+            printCell(std::get<0>(*it), std::get<1>(*it), *std::get<2>(*it));
+    }
+
+    void find(const string& needle){
+        if (!ensureCurrent()) return;
+        const size_t limit = 50;
+        size_t hits=0;
+        for (auto& [rid, addrs] : curBank().regs)
+            for (auto& [aid, val] : addrs){
+                if (val.find(needle)==string::npos) continue;
+                if (hits++ < limit) printCell(rid, aid, val);
+            }
+        if (hits > limit) std::cout<<"... "<<(hits-limit)<<" more\n";
+        else if (hits==0) std::cout<<"No match.\n";
     }
 
     void write(){
         if (!ensureCurrent()) return;
+        collectAutosave(true); // an older snapshot must not land after this write
         string err;
         if (!saveContextFile(cfg, contextFileName(cfg, *current), ws.banks[*current], err))
             std::cout<<"Write failed: "<<err<<"\n";
-        else { dirty=false; std::cout<<"Saved "<<contextFileName(cfg,*current).string()<<"\n"; }
+        else { savedRev[*current]=ws.revision(*current); std::cout<<"Saved "<<contextFileName(cfg,*current).string()<<"\n"; }
+    }
+
+    void collectAutosave(bool wait){
+        if (!autosaveJob.valid()) return;
+        if (!wait && autosaveJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+        for (auto& [id, err] : autosaveJob.get()){
+            std::cout<<"Autosave failed: "<<err<<"\n";
+            savedRev.erase(id); // keep it dirty for the next round
+        }
+    }
+
+    void maybeAutosave(){
+        collectAutosave(false);
+        if (cfg.autosave<=0 || autosaveJob.valid()) return;
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastAutosave < std::chrono::seconds(cfg.autosave)) return;
+        std::vector<std::pair<long long, std::shared_ptr<const Bank>>> snaps;
+        for (auto& [id,b] : ws.banks){
+            if (!isDirty(id)) continue;
+            snaps.emplace_back(id, std::make_shared<const Bank>(b));
+            savedRev[id] = ws.revision(id);
+        }
+        if (snaps.empty()) return;
+        lastAutosave = now;
+        autosaveJob = std::async(std::launch::async, [snaps=std::move(snaps), c=cfg](){
+            std::vector<std::pair<long long,string>> failed;
+            for (auto& [id, b] : snaps){
+                string err;
+                if (!saveContextFile(c, contextFileName(c, id), *b, err)) failed.emplace_back(id, err);
+            }
+            return failed;
+        });
+    }
+
+    void autosaveLoop(){
+        std::unique_lock lk(wsMu);
+        while (!autosaveCv.wait_for(lk, std::chrono::seconds(1), [&]{ return stopping; })) maybeAutosave();
     }
 
     void insert(const string& addrTok, const string& value){
         if (!ensureCurrent()) return;
         long long addr;
         if (!parseIntBase(addrTok, cfg.base, addr)) { std::cout<<"Bad address\n"; return; }
-        ws.banks[*current].regs[1][addr] = value; dirty=true;
+        if (auto* ov = overlay()) ov->set(*current, 1, addr, value);
+        else { ws.banks[*current].regs[1][addr] = value; ws.touchCell(*current, 1, addr); }
     }
 
     void insertR(const string& regTok, const string& addrTok, const string& value){
@@ -74,16 +289,18 @@ R"(Commands:
         long long reg=1, addr=0;
         if (!parseIntBase(regTok, cfg.base, reg))  { std::cout<<"Bad register\n"; return; }
         if (!parseIntBase(addrTok, cfg.base, addr)){ std::cout<<"Bad address\n";  return; }
-        ws.banks[*current].regs[reg][addr] = value; dirty=true;
+        if (auto* ov = overlay()) ov->set(*current, reg, addr, value);
+        else { ws.banks[*current].regs[reg][addr] = value; ws.touchCell(*current, reg, addr); }
     }
 
     void del(const string& addrTok){
         if (!ensureCurrent()) return;
         long long addr; if (!parseIntBase(addrTok, cfg.base, addr)) { std::cout<<"Bad address\n"; return; }
+        if (overlay()){ overlayErase(1, addr); return; }
         auto& m = ws.banks[*current].regs[1];
         size_t n = m.erase(addr);
         std::cout<<(n? "Deleted.\n":"No such address.\n");
-        if (n) dirty=true;
+        if (n) ws.touch(*current);
     }
 
     void delR(const string& regTok, const string& addrTok){
@@ -91,41 +308,333 @@ R"(Commands:
         long long reg=1, addr=0;
         if (!parseIntBase(regTok, cfg.base, reg))  { std::cout<<"Bad register\n"; return; }
         if (!parseIntBase(addrTok, cfg.base, addr)){ std::cout<<"Bad address\n";  return; }
+        if (overlay()){ overlayErase(reg, addr); return; }
         auto& regs = ws.banks[*current].regs;
         auto itR = regs.find(reg);
         if (itR==regs.end()){ std::cout<<"No such register.\n"; return; }
         size_t n = itR->second.erase(addr);
         std::cout<<(n? "Deleted.\n":"No such address.\n");
-        if (n) dirty=true;
+        if (n) ws.touch(*current);
         if (itR->second.empty()) regs.erase(itR); // tidy up empty register
     }
 
-    void readMerge(const string& path){
-        if (!ensureCurrent()) return;
-        std::ifstream in(path, std::ios::binary);
-        if (!in){ std::cout<<"Cannot open "<<path<<"\n"; return; }
-        string text( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
-        Bank tmp;
-        auto pr = parseBankText(text, cfg, tmp);
-        if (!pr.ok){ std::cout<<"Parse failed: "<<pr.err<<"\n"; return; }
-        for (auto& [rid, addrs] : tmp.regs)
-            for (auto& [aid, val] : addrs)
-                ws.banks[*current].regs[rid][aid] = val;
-        if (ws.banks[*current].title.empty()) ws.banks[*current].title = tmp.title;
-        dirty=true; std::cout<<"Merged.\n";
+    void overlayErase(long long reg, long long addr){
+        string v;
+        if (!lookupCell(ws, overlay(), *current, reg, addr, v)){ std::cout<<"No such address.\n"; return; }
+        overlay()->erase(*current, reg, addr);
+        std::cout<<"Deleted.\n";
+    }
+
+    void overlayCmd(const std::vector<string>& tok){
+        const string sub = tok.size()>=2? tok[1] : "status";
+        if (sub=="status"){
+            if (overlays.empty()){ std::cout<<"(no overlays)\n"; return; }
+            for (auto& [name, ov] : overlays)
+                std::cout<<name<<"  "<<ov.size()<<" cells"<<(name==activeOverlay? " [active]":"")<<"\n";
+        } else if (sub=="new" && tok.size()>=3){
+            if (tok[2]=="base" || overlays.count(tok[2])){ std::cout<<"Overlay name in use\n"; return; }
+            overlays[tok[2]]; activeOverlay = tok[2];
+            std::cout<<"Editing overlay '"<<activeOverlay<<"'\n";
+        } else if (sub=="use" && tok.size()>=3){
+            if (tok[2]=="base"){ activeOverlay.clear(); std::cout<<"Editing base\n"; return; }
+            if (!overlays.count(tok[2])){ std::cout<<"No such overlay\n"; return; }
+            activeOverlay = tok[2]; std::cout<<"Editing overlay '"<<activeOverlay<<"'\n";
+        } else if (sub=="commit" || sub=="discard"){
+            if (!overlay()){ std::cout<<"No active overlay\n"; return; }
+            if (sub=="commit") std::cout<<"Committed "<<commitOverlay(ws, *overlay())<<" cells from '"<<activeOverlay<<"'\n";
+            else std::cout<<"Discarded '"<<activeOverlay<<"'\n";
+            overlays.erase(activeOverlay); activeOverlay.clear();
+        } else std::cout<<"Usage: :overlay [status|new <name>|use <name|base>|commit|discard]\n";
+    }
+
+    void delRange(const string& regTok, const string& fromTok, const string& toTok){
+        if (!ensureCurrent() || !noOverlay()) return;
+        long long reg=0, from=0, to=0;
+        if (!parseIntBase(regTok, cfg.base, reg))  { std::cout<<"Bad register\n"; return; }
+        if (!parseIntBase(fromTok, cfg.base, from) || !parseIntBase(toTok, cfg.base, to)){ std::cout<<"Bad address\n"; return; }
+        size_t n = eraseRange(ws.banks[*current], reg, from, to);
+        if (n) ws.touch(*current);
+        std::cout<<"Deleted "<<n<<" cells.\n";
+    }
+
+    void moveCells(long long reg, long long from, long long to, long long dstReg, long long dstFrom, bool refs){
+        std::vector<CellMove> moved; string err;
+        if (!moveRange(ws.banks[*current], reg, from, to, dstReg, dstFrom, moved, err)){
+            std::cout<<"Move refused: "<<err<<"\n"; return;
+        }
+        if (!moved.empty()) ws.touch(*current);
+        std::cout<<"Moved "<<moved.size()<<" cells.";
+        if (!refs){ std::cout<<"\n"; return; }
+        std::set<long long> touched, pending; // pending: unsaved edits of their own
+        for (auto& [id, b] : ws.banks) if (id != *current && isDirty(id)) pending.insert(id);
+        std::cout<<" Rewrote "<<rewriteMovedRefs(cfg, ws, *current, moved, &touched)<<" references.\n";
+        // Other banks were never opened here, so :w would not reach them: save
+        // now, unless that would also write edits nobody asked to save yet.
+        if (touched.size() > touched.count(*current)) collectAutosave(true);
+        for (long long id : touched){
+            if (id == *current) continue;
+            if (pending.count(id)){
+                std::cout<<"  Not saved (has unsaved edits): "<<cfg.prefix<<toBaseN(id, cfg.base, cfg.widthBank)<<"; :switch to it and :w\n";
+                continue;
+            }
+            string err;
+            auto path = contextFileName(cfg, id);
+            if (!saveContextFile(cfg, path, ws.banks[id], err)) std::cout<<"  Write failed: "<<err<<"\n";
+            else { savedRev[id] = ws.revision(id); std::cout<<"  Saved "<<path.string()<<"\n"; }
+        }
+    }
+
+    void moveRangeCmd(const std::vector<string>& tok){
+        if (!ensureCurrent() || !noOverlay()) return;
+        long long reg=0, from=0, to=0, dreg=0, dfrom=0;
+        if (!parseIntBase(tok[1], cfg.base, reg) || !parseIntBase(tok[4], cfg.base, dreg)){ std::cout<<"Bad register\n"; return; }
+        if (!parseIntBase(tok[2], cfg.base, from) || !parseIntBase(tok[3], cfg.base, to) ||
+            !parseIntBase(tok[5], cfg.base, dfrom)){ std::cout<<"Bad address\n"; return; }
+        moveCells(reg, from, to, dreg, dfrom, tok.size()>=7 && tok[6]=="refs");
+    }
+
+    void shiftCmd(const std::vector<string>& tok){
+        if (!ensureCurrent() || !noOverlay()) return;
+        long long reg=0, from=0, delta=0;
+        if (!parseIntBase(tok[1], cfg.base, reg)){ std::cout<<"Bad register\n"; return; }
+        if (!parseIntBase(tok[2], cfg.base, from)){ std::cout<<"Bad address\n"; return; }
+        bool neg = !tok[3].empty() && tok[3][0]=='-';
+        if (!parseIntBase(neg? tok[3].substr(1) : tok[3], cfg.base, delta)){ std::cout<<"Bad delta\n"; return; }
+        if (neg) delta = -delta;
+        moveCells(reg, from, std::numeric_limits<long long>::max(), reg, from + delta, tok.size()>=5 && tok[4]=="refs");
+    }
+
+    static void printMerge(const MergeStats& st, const Config& cfg){
+        std::cout<<"Merged: "<<st.added<<" added, "<<st.replaced<<" replaced, "<<st.kept<<" kept.\n";
+        for (auto& [r,a] : st.conflicts)
+            std::cout<<"  conflict "<<toBaseN(r,cfg.base,cfg.widthReg)<<"."<<toBaseN(a,cfg.base,cfg.widthAddr)<<"\n";
+    }
+
+    bool policyArg(const std::vector<string>& tok, size_t i, MergePolicy& pol){
+        pol = MergePolicy::Overwrite;
+        if (tok.size()<=i || parseMergePolicy(tok[i], pol)) return true;
+        std::cout<<"Policy must be keep, overwrite or report\n"; return false;
+    }
+
+    // :r <path|glob> [policy] — files are read and parsed in parallel, then
+    // merged in file-name order so later files win under 'overwrite'.
+    void readMerge(const std::vector<string>& tok){
+        if (!ensureCurrent() || !noOverlay()) return;
+        MergePolicy pol; if (!policyArg(tok, 2, pol)) return;
+        auto files = expandGlob(tok[1]);
+        if (files.empty()){ std::cout<<"No files match "<<tok[1]<<"\n"; return; }
+        std::vector<Bank> parsed(files.size());
+        std::vector<string> errs(files.size());
+        parallelFor(files.size(), [&](size_t b, size_t e){
+            for (size_t i=b; i<e; ++i){
+                std::ifstream in(files[i], std::ios::binary);
+                if (!in){ errs[i] = "cannot open"; continue; }
+                string text( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+                auto pr = parseBankText(text, cfg, parsed[i]);
+                if (!pr.ok) errs[i] = "parse failed: "+pr.err;
+            }
+        }, 1);
+        MergeStats total;
+        for (size_t i=0; i<files.size(); ++i){
+            if (!errs[i].empty()){ std::cout<<files[i].string()<<": "<<errs[i]<<"\n"; continue; }
+            auto st = mergeBank(ws.banks[*current], std::move(parsed[i]), pol);
+            total.added += st.added; total.replaced += st.replaced; total.kept += st.kept;
+            total.conflicts.insert(total.conflicts.end(), st.conflicts.begin(), st.conflicts.end());
+        }
+        if (total.added || total.replaced) ws.touch(*current);
+        printMerge(total, cfg);
+    }
+
+    // :merge <ctx> [policy] — merges a copy of another bank into the current one.
+    void mergeCtx(const std::vector<string>& tok){
+        if (!ensureCurrent() || !noOverlay()) return;
+        MergePolicy pol; if (!policyArg(tok, 2, pol)) return;
+        long long id=0; string err;
+        if (!ctxId(tok[1], id)) return;
+        if (id==*current){ std::cout<<"Cannot merge a bank into itself\n"; return; }
+        if (!ensureBankLoadedInWorkspace(cfg, ws, id, err)){ std::cout<<err<<"\n"; return; }
+        Bank copy = ws.banks[id];
+        auto st = mergeBank(ws.banks[*current], std::move(copy), pol);
+        if (st.added || st.replaced) ws.touch(*current);
+        printMerge(st, cfg);
+    }
+
+    bool ctxId(const string& name, long long& id){
+        string token = (!name.empty() && name[0]==cfg.prefix)? name.substr(1) : name;
+        if (parseIntBase(token, cfg.base, id)) return true;
+        std::cout<<"Bad context id: "<<name<<"\n"; return false;
+    }
+
+    // Prints at most `limit` diff lines across calls; returns the remainder.
+    size_t printDiff(long long bankId, const std::vector<CellDiff>& d, size_t limit){
+        if (d.empty()) return limit;
+        std::cout<<cfg.prefix<<toBaseN(bankId,cfg.base,cfg.widthBank)<<"\n";
+        for (auto& c : d){
+            if (limit==0) break;
+            --limit;
+            string at = toBaseN(c.reg,cfg.base,cfg.widthReg)+"."+toBaseN(c.addr,cfg.base,cfg.widthAddr);
+            if (c.kind==DiffKind::Added)        std::cout<<"+ "<<at<<"\t"<<c.after<<"\n";
+            else if (c.kind==DiffKind::Removed) std::cout<<"- "<<at<<"\t"<<c.before<<"\n";
+            else                                std::cout<<"~ "<<at<<"\t"<<c.before<<"\t=> "<<c.after<<"\n";
+        }
+        return limit;
+    }
+
+    static void printDiffStats(const DiffStats& st){
+        std::cout<<st.added<<" added, "<<st.removed<<" removed, "<<st.changed<<" changed ("
+                 <<st.regsSkipped<<" identical registers skipped)\n";
+    }
+
+    // :diff <ctxA> <ctxB> [resolved]
+    void diffCtx(const std::vector<string>& tok){
+        long long a=0, b=0; string err;
+        if (!ctxId(tok[1], a) || !ctxId(tok[2], b)) return;
+        for (long long id : {a, b})
+            if (!ensureBankLoadedInWorkspace(cfg, ws, id, err)){ std::cout<<err<<"\n"; return; }
+        const bool resolved = tok.size()>=4 && tok[3]=="resolved";
+        DiffStats st;
+        auto d = resolved? diffBanks(resolvedBank(cfg, ws, a), resolvedBank(cfg, ws, b), st)
+                         : diffBanks(ws.banks[a], ws.banks[b], st, {&ws, a}, {&ws, b});
+        if (printDiff(a, d, 200)==0 && d.size()>200) std::cout<<"... "<<(d.size()-200)<<" more\n";
+        printDiffStats(st);
+    }
+
+    // :diffdir <dir> [resolved] — loaded workspace (before) against the
+    // context files in dir (after). Banks only in dir are loaded from files/
+    // when present there.
+    void diffDir(const std::vector<string>& tok){
+        std::vector<string> errs;
+        Workspace other = loadWorkspaceDir(cfg, tok[1], errs);
+        for (auto& e : errs) std::cout<<e<<"\n";
+        const bool resolved = tok.size()>=3 && tok[2]=="resolved";
+        std::set<long long> ids;
+        for (auto& [id,b] : other.banks){ string err; (void)ensureBankLoadedInWorkspace(cfg, ws, id, err); ids.insert(id); }
+        for (auto& [id,b] : ws.banks) ids.insert(id);
+        DiffStats st; size_t limit = 200, total = 0;
+        for (long long id : ids){
+            Bank none;
+            const bool inA = ws.banks.count(id), inB = other.banks.count(id);
+            Bank ra = resolved && inA? resolvedBank(cfg, ws, id) : Bank{};
+            Bank rb = resolved && inB? resolvedBank(cfg, other, id, false) : Bank{};
+            const Bank& A = resolved? ra : inA? ws.banks[id] : none;
+            const Bank& B = resolved? rb : inB? other.banks[id] : none;
+            auto d = diffBanks(A, B, st, resolved || !inA? DigestSource{} : DigestSource{&ws, id});
+            total += d.size();
+            limit = printDiff(id, d, limit);
+        }
+        if (total > 200) std::cout<<"... "<<(total-200)<<" more\n";
+        printDiffStats(st);
+    }
+
+    // :hotspots [n] — top n cells by fan-in, fan-out, depth and resolved size
+    // across every bank under files/.
+    void hotspots(size_t n){
+        preloadAll(cfg, ws);
+        auto stats = analyzeHotspots(cfg, ws);
+        std::cout<<stats.size()<<" cells in "<<ws.banks.size()<<" banks\n";
+        auto top = [&](const char* title, size_t CellStats::*field){
+            std::vector<const CellStats*> v;
+            for (auto& c : stats) if (c.*field) v.push_back(&c);
+            size_t k = std::min(n, v.size());
+            std::partial_sort(v.begin(), v.begin()+k, v.end(), [&](auto* a, auto* b){ return a->*field > b->*field; });
+            std::cout<<title<<":\n";
+            for (size_t i=0; i<k; ++i)
+                std::cout<<"  "<<cfg.prefix<<toBaseN(v[i]->bank,cfg.base,cfg.widthBank)<<"."
+                         <<toBaseN(v[i]->reg,cfg.base,cfg.widthReg)<<"."<<toBaseN(v[i]->addr,cfg.base,cfg.widthAddr)
+                         <<"\tfan-in "<<v[i]->fanIn<<"  fan-out "<<v[i]->fanOut
+                         <<"  depth "<<v[i]->depth<<"  size "<<v[i]->resolvedSize<<"\n";
+            if (k==0) std::cout<<"  (none)\n";
+        };
+        top("Most referenced", &CellStats::fanIn);
+        top("Most references", &CellStats::fanOut);
+        top("Deepest chains", &CellStats::depth);
+        top("Largest resolved", &CellStats::resolvedSize);
+    }
+
+    // :freeze [ctx|all] — read-optimised copies for banks you are not editing.
+    // The current bank is never frozen by 'all'; any edit thaws a bank.
+    void freezeCmd(const std::vector<string>& tok){
+        size_t n = 0;
+        if (tok.size()>=2 && tok[1]!="all"){
+            long long id=0; string err;
+            if (!ctxId(tok[1], id)) return;
+            if (!ensureBankLoadedInWorkspace(cfg, ws, id, err)){ std::cout<<err<<"\n"; return; }
+            ws.freeze(id); n = ws.frozen.count(id);
+        } else {
+            for (auto& [id, b] : ws.banks) if (!current || id != *current){ ws.freeze(id); n += ws.frozen.count(id); }
+        }
+        std::cout<<"Froze "<<n<<" banks.\n";
+    }
+
+    // :dedup [on|off] — how much identical values cost, and whether frozen
+    // banks share one intern pool (banks frozen earlier keep their own).
+    void dedupCmd(const std::vector<string>& tok){
+        if (tok.size()>=2 && tok[1]=="on" && !ws.intern) ws.intern = std::make_shared<InternPool>();
+        if (tok.size()>=2 && tok[1]=="off") ws.intern.reset();
+        auto show = [](const char* what, const InternStats& st){
+            std::cout<<what<<": "<<st.values<<" values, "<<st.bytes<<" bytes; "
+                     <<st.unique<<" unique, "<<st.uniqueBytes<<" bytes (ratio "
+                     <<std::fixed<<std::setprecision(2)<<st.ratio()<<std::defaultfloat<<")\n";
+        };
+        show("Loaded banks", dedupStats(ws.banks));
+        if (ws.intern) show("Intern pool", ws.intern->stats());
+        else std::cout<<"Intern pool: off\n";
+    }
+
+    // :cache [on|off|clear] — cells resolved by earlier runs are reused while
+    // they and everything they read are unchanged.
+    void cacheCmd(const std::vector<string>& tok){
+        if (tok.size()>=2 && tok[1]=="on") ws.cacheDir = P.cache;
+        if (tok.size()>=2 && tok[1]=="off") ws.cacheDir.clear();
+        if (tok.size()>=2 && tok[1]=="clear"){
+            std::error_code ec;
+            auto n = fs::remove_all(P.cache, ec);
+            std::cout<<"Removed "<<(ec? 0 : n)<<" cache files.\n";
+        }
+        std::cout<<"Cache "<<(ws.cacheDir.empty()? "off" : ws.cacheDir.string())
+                 <<": "<<ws.cacheHits<<" hits, "<<ws.cacheMisses<<" misses this session\n";
+    }
+
+    // :stats [on|off|reset] — allocations charged to load, parse, resolve
+    // and export since tracking was switched on.
+    void statsCmd(const std::vector<string>& tok){
+        if (tok.size()>=2 && tok[1]=="on") allocTracking() = true;
+        if (tok.size()>=2 && tok[1]=="off") allocTracking() = false;
+        if (tok.size()>=2 && tok[1]=="reset") resetAllocCounts();
+        std::cout<<"Allocation tracking "<<(allocTracking()? "on" : "off")<<"\n";
+        for (size_t i = 0; i < size_t(AllocOp::Count); ++i){
+            auto& c = allocCounts(AllocOp(i));
+            std::cout<<"  "<<std::left<<std::setw(12)<<allocOpName(AllocOp(i))<<std::right
+                     <<std::setw(12)<<c.count.load()<<" allocs"<<std::setw(14)<<c.bytes.load()<<" bytes\n";
+        }
+    }
+
+    // :publish [path] / :attach <path> — share one parsed workspace between processes.
+    void publishCmd(const std::vector<string>& tok){
+        preloadAll(cfg, ws);
+        fs::path out = tok.size()>=2? fs::path(tok[1]) : P.outdir / "workspace.img";
+        string err;
+        if (!publishWorkspace(cfg, ws, out, err)) std::cout<<"Publish failed: "<<err<<"\n";
+        else std::cout<<"Published "<<ws.banks.size()<<" banks to "<<out.string()<<"\n";
+    }
+
+    void attachCmd(const string& path){
+        string err;
+        if (!attachWorkspace(cfg, ws, path, err)){ std::cout<<"Attach failed: "<<err<<"\n"; return; }
+        std::cout<<"Attached "<<ws.image->bankCount()<<" banks, "<<ws.image->cellCount()<<" cells (read-only)\n";
     }
 
     void resolveOut(){
         if (!ensureCurrent()) return;
-        auto txt = resolveBankToText(cfg, ws, *current);
         auto outp = outResolvedName(cfg, *current);
-        std::ofstream out(outp, std::ios::binary); out<<txt;
-        std::cout<<"Wrote "<<outp<<"\n";
+        string err;
+        if (!resolveBankToFile(cfg, ws, *current, outp, err, overlay())) std::cout<<"Resolve failed: "<<err<<"\n";
+        else std::cout<<"Wrote "<<outp<<"\n";
     }
 
     void exportJson(){
         if (!ensureCurrent()) return;
-        auto js = exportBankToJSON(cfg, ws, *current);
+        auto js = exportBankToJSON(cfg, ws, *current, overlay());
         auto outp = outJsonName(cfg, *current);
         std::ofstream out(outp, std::ios::binary); out<<js;
         std::cout<<"Wrote "<<outp<<"\n";
@@ -134,12 +643,24 @@ R"(Commands:
     void repl(){
         P.ensure();
         loadConfig();
+        ws.cacheDir = P.cache;
         std::cout<<"scripted CLI — shared core\nType :help for commands.\n\n";
 		std::cout << "scripted CLI — " << scripted::platformName() << (scripted::isWSL() ? " (WSL)" : "") << "\n";
         string line;
+        std::unique_lock busy(wsMu);
+        std::thread autosaver([this]{ autosaveLoop(); });
+        // Reads a line with wsMu released, so autosave can run while idle.
+        auto readLine = [&](string& l){
+            std::cout<<std::flush;
+            busy.unlock();
+            bool ok = bool(std::getline(std::cin, l));
+            busy.lock();
+            return ok;
+        };
         while (true){
+            if (!activeOverlay.empty()) std::cout<<"["<<activeOverlay<<"] ";
             std::cout<<">> ";
-            if (!std::getline(std::cin, line)) break;
+            if (!readLine(line)) break;
             string s = trim(line);
             if (s.empty()) continue;
 
@@ -151,9 +672,12 @@ R"(Commands:
             if (s==":resolve"){ resolveOut(); continue; }
             if (s==":export"){ exportJson(); continue; }
             if (s==":q"){
-                if (dirty){
+                collectAutosave(true);
+                bool layers = std::any_of(overlays.begin(), overlays.end(), [](auto& o){ return !o.second.empty(); });
+                if (anyDirty() || layers){
+                    if (layers) std::cout<<"Uncommitted overlays. ";
                     std::cout<<"Unsaved changes. Type :w to save or :q again to quit.\n>> ";
-                    string l2; if (!std::getline(std::cin,l2)) break;
+                    string l2; if (!readLine(l2)) break;
                     if (trim(l2)==":q") break; else { s = trim(l2); }
                 } else break;
             }
@@ -167,7 +691,7 @@ R"(Commands:
                 string status; if (openCtx(cfg, ws, tok[1], status)){
                     string token = (tok[1][0]==cfg.prefix)? tok[1].substr(1): tok[1];
                     long long id; parseIntBase(token, cfg.base, id);
-                    current = id;
+                    current = id; savedRev[id] = ws.revision(id);
                 }
                 std::cout<<status<<"\n"; continue;
             }
@@ -177,6 +701,7 @@ R"(Commands:
                 long long id; if (!parseIntBase(token, cfg.base, id)){ std::cout<<"Bad id\n"; continue; }
                 if (!ws.banks.count(id)){
                     string status; if (!openCtx(cfg, ws, name, status)){ std::cout<<status<<"\n"; continue; }
+                    savedRev[id] = ws.revision(id);
                 }
                 current = id; std::cout<<"Switched to "<<name<<"\n"; continue;
             }
@@ -188,11 +713,42 @@ R"(Commands:
                 string value; for (size_t i=3;i<tok.size();++i){ if (i>3) value.push_back(' '); value += tok[i]; }
                 insertR(tok[1], tok[2], value); continue;
             }
+            if (tok[0]==":show" && tok.size()>=2){ showRange(tok[1]); continue; }
+            if ((tok[0]==":head" || tok[0]==":tail")){
+                size_t n=20;
+                if (tok.size()>=2){ try { n = std::stoul(tok[1]); } catch(...) { std::cout<<"Bad count\n"; continue; } }
+                if (tok[0]==":head") head(n); else tail(n);
+                continue;
+            }
+            if (tok[0]==":find" && tok.size()>=2){ find(trim(s.substr(s.find(' ')))); continue; }
+            if (tok[0]==":delrange" && tok.size()>=4){ delRange(tok[1], tok[2], tok[3]); continue; }
+            if (tok[0]==":moverange" && tok.size()>=6){ moveRangeCmd(tok); continue; }
+            if (tok[0]==":shift" && tok.size()>=4){ shiftCmd(tok); continue; }
             if (tok[0]==":del" && tok.size()>=2){ del(tok[1]); continue; }
             if (tok[0]==":delr" && tok.size()>=3){ delR(tok[1], tok[2]); continue; }
-            if (tok[0]==":r" && tok.size()>=2){ readMerge(tok[1]); continue; }
+            if (tok[0]==":r" && tok.size()>=2){ readMerge(tok); continue; }
+            if (tok[0]==":merge" && tok.size()>=2){ mergeCtx(tok); continue; }
+            if (tok[0]==":overlay"){ overlayCmd(tok); continue; }
+            if (tok[0]==":hotspots"){
+                size_t n=10;
+                if (tok.size()>=2){ try { n = std::stoul(tok[1]); } catch(...) { std::cout<<"Bad count\n"; continue; } }
+                hotspots(n); continue;
+            }
+            if (tok[0]==":publish"){ publishCmd(tok); continue; }
+            if (tok[0]==":freeze"){ freezeCmd(tok); continue; }
+            if (tok[0]==":dedup"){ dedupCmd(tok); continue; }
+            if (tok[0]==":cache"){ cacheCmd(tok); continue; }
+            if (tok[0]==":stats"){ statsCmd(tok); continue; }
+            if (tok[0]==":attach" && tok.size()>=2){ attachCmd(tok[1]); continue; }
+            if (tok[0]==":diff" && tok.size()>=3){ diffCtx(tok); continue; }
+            if (tok[0]==":diffdir" && tok.size()>=2){ diffDir(tok); continue; }
             if (tok[0]==":set" && tok.size()>=2){
                 if (tok[1]=="prefix" && tok.size()>=3){ cfg.prefix = tok[2][0]; saveCfg(); std::cout<<"prefix="<<cfg.prefix<<"\n"; }
+                else if (tok[1]=="autosave" && tok.size()>=3){
+                    int sec;
+                    try { sec = std::stoi(tok[2]); } catch(...) { std::cout<<"Bad seconds\n"; continue; }
+                    cfg.autosave=std::max(0, sec); saveCfg(); std::cout<<"autosave="<<cfg.autosave<<"s\n";
+                }
                 else if (tok[1]=="base" && tok.size()>=3){ int b=std::stoi(tok[2]); if (b<2||b>36) std::cout<<"base 2..36\n"; else { cfg.base=b; saveCfg(); std::cout<<"base="<<cfg.base<<"\n"; } }
                 else if (tok[1]=="widths"){
                     for(size_t i=2;i<tok.size();++i){
@@ -208,11 +764,618 @@ R"(Commands:
 
             std::cout<<"Unknown command. :help\n";
         }
+        stopping = true;
+        autosaveCv.notify_all();
+        busy.unlock();
+        autosaver.join();
+        busy.lock();
+        collectAutosave(true);
         std::cout<<"bye.\n";
     }
 };
 
-int main(){
+// ───────── Batch resolve ─────────
+// scripted --resolve-all [--workers N] [--retries R] [--shard K/M]
+//   Coordinator: splits the banks under files/ (or shard K of M of them, for
+//   running one slice per cluster node) across N local worker processes and
+//   retries the banks of workers that fail or die.
+// scripted --resolve-worker <id,id,...>
+//   Worker: loads only the listed banks (plus whatever they reference),
+//   writes files/out/<bank>.resolved.txt and reports "ok <id>" or
+//   "fail <id>\t<reason>" per bank on stdout.
+// scripted --publish [image]
+//   Parses every bank once and writes a shared read-only workspace image.
+// scripted --attach <image> (--resolve [ctx...] | --resolve-all ... | --resolve-worker ...)
+//   Reads banks from the mapped image instead of parsing files/.
+// scripted --bench [ctx...] [--iters N] [--counters] [--allocs]
+//   Times parseBankText, Resolver::resolve, writeBankText and exportBankToJSON
+//   over the given banks (default: all); --counters adds hardware counters,
+//   --allocs allocation counts and bytes per iteration.
+// scripted --watch [--workers N] [--debounce MS]
+//   Resolves every bank, then keeps files/out fresh: each burst of changes in
+//   files/ re-resolves only the banks it can reach, on worker processes.
+
+static int resolveWorker(const std::vector<long long>& ids, std::ostream& report, const string& image){
+    Paths P; P.ensure();
+    Config cfg = loadConfig(P);
+    Workspace ws;
+    ws.autoFreeze = true; // workers never edit: every bank they load is read-only
+    ws.intern = std::make_shared<InternPool>();
+    ws.cacheDir = P.cache;
+    string aerr;
+    if (!image.empty() && !attachWorkspace(cfg, ws, image, aerr)){
+        for (long long id : ids) report<<"fail "<<id<<"\t"<<aerr<<"\n";
+        return 1;
+    }
+    int failed = 0;
+    for (long long id : ids){
+        string err;
+        // Image banks are resolved and walked in place (see emitResolvedBank).
+        if ((ws.image && ws.image->hasBank(id)) || ensureBankLoadedInWorkspace(cfg, ws, id, err)){
+            auto outp = outResolvedName(cfg, id);
+            auto tmp = outp; tmp += ".tmp";
+            (void)resolveBankToFile(cfg, ws, id, tmp, err);
+            std::error_code ec;
+            if (err.empty()) fs::rename(tmp, outp, ec);
+            if (ec) err = ec.message();
+        }
+        if (err.empty()) report<<"ok "<<id<<"\n"<<std::flush;
+        else { report<<"fail "<<id<<"\t"<<err<<"\n"<<std::flush; ++failed; }
+    }
+    return failed? 1 : 0;
+}
+
+// Feeds one worker status line to the coordinator's bookkeeping.
+static void workerLine(const string& line, std::set<long long>& done){
+    if (line.rfind("ok ", 0)==0) done.insert(std::stoll(line.substr(3)));
+    else if (line.rfind("fail ", 0)==0) std::cerr<<"worker: "<<line<<"\n";
+}
+
+// Runs one worker per part; returns the banks reported ok.
+static std::set<long long> runWorkers(const std::vector<std::vector<long long>>& parts, const char* self, const string& image){
+    std::set<long long> done;
+#if defined(_WIN32)
+    (void)self; // no fork/exec: run the shards in-process, one after another
+    for (auto& ids : parts){
+        std::ostringstream os;
+        resolveWorker(ids, os, image);
+        std::istringstream is(os.str());
+        for (string line; std::getline(is, line);) workerLine(line, done);
+    }
+#else
+    struct Child { pid_t pid; int fd; string buf; };
+    std::vector<Child> kids;
+    for (auto& ids : parts){
+        string list;
+        for (long long id : ids) list += (list.empty()? "" : ",") + std::to_string(id);
+        int fd[2];
+        if (pipe(fd)!=0){ std::cerr<<"pipe failed\n"; continue; }
+        pid_t pid = fork();
+        if (pid==0){
+            dup2(fd[1], 1); close(fd[0]); close(fd[1]);
+            std::vector<const char*> av{self};
+            if (!image.empty()){ av.push_back("--attach"); av.push_back(image.c_str()); }
+            av.push_back("--resolve-worker"); av.push_back(list.c_str()); av.push_back(nullptr);
+            execv(self, const_cast<char* const*>(av.data()));
+            _exit(127);
+        }
+        close(fd[1]);
+        if (pid<0){ close(fd[0]); std::cerr<<"fork failed\n"; continue; }
+        kids.push_back({pid, fd[0], {}});
+    }
+    // Stream status lines from every worker as they arrive.
+    std::vector<pollfd> fds;
+    for (auto& k : kids) fds.push_back({k.fd, POLLIN, 0});
+    size_t open = kids.size();
+    char chunk[4096];
+    while (open){
+        if (poll(fds.data(), fds.size(), -1) < 0) break;
+        for (size_t i=0; i<fds.size(); ++i){
+            if (fds[i].fd<0 || !(fds[i].revents & (POLLIN|POLLHUP|POLLERR))) continue;
+            ssize_t n = read(fds[i].fd, chunk, sizeof chunk);
+            if (n<=0){ close(fds[i].fd); fds[i].fd = -1; --open; continue; }
+            auto& buf = kids[i].buf;
+            buf.append(chunk, size_t(n));
+            for (size_t nl; (nl = buf.find('\n')) != string::npos; buf.erase(0, nl+1))
+                workerLine(buf.substr(0, nl), done);
+        }
+    }
+    for (auto& k : kids){
+        int status = 0;
+        waitpid(k.pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status)==127)
+            std::cerr<<"worker "<<k.pid<<" did not finish cleanly\n";
+    }
+#endif
+    return done;
+}
+
+// Largest first onto the lightest worker keeps the shards balanced.
+static std::vector<std::vector<long long>> balanceParts(std::vector<std::pair<uintmax_t, long long>> pending, unsigned workers){
+    std::sort(pending.rbegin(), pending.rend());
+    size_t n = std::min<size_t>(std::max(workers, 1u), pending.size());
+    std::vector<std::vector<long long>> parts(n);
+    std::vector<uintmax_t> load(n);
+    for (auto& [size, id] : pending){
+        size_t w = size_t(std::min_element(load.begin(), load.end()) - load.begin());
+        parts[w].push_back(id); load[w] += size + 1;
+    }
+    return parts;
+}
+
+static int resolveAll(unsigned workers, int retries, long long shardK, long long shardM, const char* self, const string& image){
+    Paths P; P.ensure();
+    Config cfg = loadConfig(P);
+    std::vector<std::pair<uintmax_t, long long>> pending; // (file size, id)
+    long long idx = 0;
+    for (auto& [id, path] : contextFilesIn(cfg, P.root)){
+        if (shardM>0 && idx++ % shardM != shardK) continue;
+        std::error_code ec;
+        pending.push_back({fs::file_size(path, ec), id});
+    }
+    if (pending.empty() && !image.empty()){ // image-only host: shard the image's banks
+        Workspace probe; string err;
+        if (!attachWorkspace(cfg, probe, image, err)){ std::cerr<<err<<"\n"; return 1; }
+        for (long long id : probe.image->bankIds())
+            if (shardM<=0 || idx++ % shardM == shardK) pending.push_back({1, id});
+    }
+    const size_t total = pending.size();
+    for (int attempt=0; attempt<=retries && !pending.empty(); ++attempt){
+        if (attempt) std::cerr<<"retrying "<<pending.size()<<" banks\n";
+        auto done = runWorkers(balanceParts(pending, workers), self, image);
+        std::erase_if(pending, [&](auto& p){ return done.count(p.second)!=0; });
+    }
+    std::cout<<"Resolved "<<(total - pending.size())<<"/"<<total<<" banks into "<<P.outdir.string()<<"\n";
+    for (auto& [size, id] : pending) std::cout<<"failed: "<<cfg.prefix<<toBaseN(id,cfg.base,cfg.widthBank)<<"\n";
+    return pending.empty()? 0 : 1;
+}
+
+// Blocks until something under dir changes, then until it has been quiet for
+// debounceMs; returns the paths (relative to dir, '/'-separated, as written
+// in @file(...)) that changed. inotify on Linux, a size/mtime scan elsewhere.
+// Subdirectories are watched too, including ones created later, except the
+// `skip` ones, so the workers' writes under out/ and .cache/ never wake it.
+// If the kernel queue overflowed, events were lost: overflowed() then says
+// so once, and the caller must treat everything as changed.
+class DirWatch {
+public:
+    DirWatch(fs::path d, int debounce, std::vector<fs::path> skipDirs = {})
+    : dir(std::move(d)), debounceMs(debounce), skip(std::move(skipDirs)) {
+#if defined(__linux__)
+        fd = inotify_init1(IN_CLOEXEC);
+        if (fd >= 0 && !watchTree(dir)){ close(fd); fd = -1; }
+#endif
+        if (fd < 0) snap = scan();
+    }
+    ~DirWatch(){
+#if defined(__linux__)
+        if (fd >= 0) close(fd);
+#endif
+    }
+    bool native() const { return fd >= 0; }
+    bool overflowed(){ return std::exchange(overflow, false); }
+
+    std::set<string> wait(){
+        std::set<string> names;
+#if defined(__linux__)
+        if (fd >= 0){
+            pollfd p{fd, POLLIN, 0};
+            for (int timeout = -1; poll(&p, 1, timeout) > 0; timeout = debounceMs){
+                alignas(inotify_event) char buf[16384];
+                ssize_t n = read(fd, buf, sizeof buf);
+                for (ssize_t i = 0; i < n; ){
+                    auto* e = reinterpret_cast<const inotify_event*>(buf + i);
+                    i += ssize_t(sizeof(inotify_event) + e->len);
+                    if (e->mask & IN_Q_OVERFLOW){ overflow = true; continue; }
+                    if (e->mask & IN_IGNORED){ dirs.erase(e->wd); continue; } // directory went away
+                    auto it = dirs.find(e->wd);
+                    if (!e->len || it == dirs.end()) continue;
+                    const fs::path rel = it->second / e->name;
+                    if (!(e->mask & IN_ISDIR)){ names.insert(rel.generic_string()); continue; }
+                    if (e->mask & (IN_CREATE|IN_MOVED_TO)) watchTree(dir / rel); // files already inside are not reported
+                }
+            }
+            if (overflow) watchTree(dir); // directories created meanwhile went unseen too
+            return names;
+        }
+#endif
+        for (bool quiet = false; names.empty() || !quiet; ){
+            std::this_thread::sleep_for(std::chrono::milliseconds(debounceMs));
+            auto now = scan();
+            size_t before = names.size();
+            for (auto& [name, st] : now) if (!snap.count(name) || snap[name] != st) names.insert(name);
+            for (auto& [name, st] : snap) if (!now.count(name)) names.insert(name);
+            quiet = names.size() == before && now == snap;
+            snap = std::move(now);
+        }
+        return names;
+    }
+
+private:
+    using Stamp = std::pair<uintmax_t, fs::file_time_type>;
+    fs::path dir;
+    int debounceMs;
+    std::vector<fs::path> skip;
+    int fd = -1;
+    bool overflow = false;
+    std::map<int, fs::path> dirs; // inotify watch -> directory relative to dir
+    std::map<string, Stamp> snap;
+
+    bool skipped(const fs::path& p) const {
+        std::error_code ec;
+        for (auto& s : skip) if (fs::equivalent(p, s, ec)) return true;
+        return false;
+    }
+#if defined(__linux__)
+    bool watchTree(const fs::path& root){
+        auto add = [&](const fs::path& p){
+            int wd = inotify_add_watch(fd, p.c_str(), IN_CLOSE_WRITE|IN_MOVED_TO|IN_MOVED_FROM|IN_DELETE|IN_CREATE);
+            if (wd < 0) return false;
+            auto rel = p.lexically_relative(dir);
+            dirs[wd] = rel == "." ? fs::path() : rel;
+            return true;
+        };
+        if (skipped(root) || !add(root)) return false;
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)){
+            if (!it->is_directory(ec)) continue;
+            if (skipped(it->path()) || !add(it->path())) it.disable_recursion_pending();
+        }
+        return true;
+    }
+#endif
+    std::map<string, Stamp> scan() const {
+        std::map<string, Stamp> out;
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)){
+            if (it->is_directory(ec)){ if (skipped(it->path())) it.disable_recursion_pending(); continue; }
+            if (!it->is_regular_file(ec)) continue;
+            out[it->path().lexically_relative(dir).generic_string()] = {it->file_size(ec), it->last_write_time(ec)};
+        }
+        return out;
+    }
+};
+
+static int watchFiles(unsigned workers, int debounceMs, const char* self, const string& image){
+    Paths P; P.ensure();
+    Config cfg = loadConfig(P);
+    std::map<long long, BankUses> uses;
+    auto load = [&](long long id, const fs::path& path){
+        Bank b; string err;
+        if (!loadContextFile(cfg, path, b, err)){ std::cerr<<path.string()<<": "<<err<<"\n"; return false; }
+        b.id = id;
+        uses[id] = bankUses(cfg, b);
+        return true;
+    };
+    auto loadAll = [&](){
+        uses.clear();
+        for (auto& [id, path] : contextFilesIn(cfg, P.root)) load(id, path);
+    };
+    auto ctxName = [&](long long id){ return cfg.prefix + toBaseN(id, cfg.base, cfg.widthBank); };
+    auto regenerate = [&](const std::set<long long>& ids){
+        std::vector<std::pair<uintmax_t, long long>> pending;
+        for (long long id : ids){
+            std::error_code ec;
+            if (uses.count(id)) pending.push_back({fs::file_size(contextFileName(cfg, id), ec), id});
+        }
+        if (pending.empty()) return;
+        auto started = std::chrono::steady_clock::now();
+        auto done = runWorkers(balanceParts(pending, workers), self, image);
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+        std::cout<<"Resolved "<<done.size()<<"/"<<pending.size()<<" banks in "<<ms<<" ms\n"<<std::flush;
+    };
+
+    DirWatch watch(P.root, debounceMs, {P.outdir, P.cache});
+    loadAll();
+    std::set<long long> all;
+    for (auto& [id, u] : uses) all.insert(id);
+    regenerate(all);
+    std::cout<<"Watching "<<P.root.string()<<(watch.native()? "" : " (polling)")<<"; Ctrl-C stops.\n"<<std::flush;
+    while (true){
+        auto names = watch.wait();
+        std::erase_if(names, [](const string& n){ return isTempName(n); }); // saves in flight
+        std::set<long long> banks;
+        std::set<string> files;
+        bool reconfigured = false;
+        for (auto& name : names){
+            if (fs::path(name) == P.config.filename()){ reconfigured = true; continue; }
+            files.insert(name); // any file may be an include
+            const fs::path path = P.root / name;
+            string stem = path.stem().string();
+            long long id;
+            if (fs::path(name).has_parent_path()) continue; // banks live directly in files/
+            if (path.extension() != ".txt" || stem.empty() || stem[0]!=cfg.prefix || !parseIntBase(stem.substr(1), cfg.base, id)) continue;
+            banks.insert(id);
+            std::error_code ec;
+            if (fs::exists(path, ec)) load(id, path);
+            else { uses.erase(id); fs::remove(outResolvedName(cfg, id), ec); std::cout<<"Removed "<<ctxName(id)<<"\n"; }
+        }
+        const bool lost = watch.overflowed();
+        if (reconfigured || lost){
+            if (reconfigured) cfg = loadConfig(P);
+            std::set<long long> gone;
+            for (auto& [id, u] : uses) gone.insert(id);
+            loadAll();
+            for (auto& [id, u] : uses) gone.erase(id);
+            if (!reconfigured) for (long long id : gone){ // deleted while events were lost
+                std::error_code ec; fs::remove(outResolvedName(cfg, id), ec); std::cout<<"Removed "<<ctxName(id)<<"\n";
+            }
+            all.clear();
+            for (auto& [id, u] : uses) all.insert(id);
+            std::cout<<(reconfigured? "Config changed" : "Change events lost")<<": resolving every bank\n";
+            regenerate(all);
+            continue;
+        }
+        // Includers also pick up the references inside what they include.
+        std::vector<long long> includers;
+        for (auto& [id, u] : uses)
+            if (!banks.count(id) && std::any_of(files.begin(), files.end(), [&](auto& f){ return u.files.count(f) > 0; }))
+                includers.push_back(id);
+        for (long long id : includers) load(id, contextFileName(cfg, id));
+        auto hit = affectedBanks(uses, banks, files);
+        std::erase_if(hit, [&](long long id){ return !uses.count(id); });
+        if (hit.empty()) continue;
+        std::cout<<"Changed:";
+        for (auto& n : names) std::cout<<" "<<n;
+        std::cout<<" -> "<<hit.size()<<" banks\n";
+        regenerate(hit);
+    }
+}
+
+// ───────── Benchmarks ─────────
+// Hardware counters for the calling thread via perf_event_open. Each event is
+// opened on its own, so a kernel or VM that lacks one still reports the rest;
+// without perf support at all, available() is false and why() says why.
+class PerfCounters {
+public:
+    static constexpr size_t kEvents = 4;
+    static constexpr const char* kNames[kEvents] = {"cycles", "instructions", "cache-misses", "branch-misses"};
+    using Values = std::array<std::optional<double>, kEvents>;
+
+    PerfCounters(){
+#if defined(__linux__)
+        const uint64_t configs[kEvents] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                           PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (size_t i = 0; i < kEvents; ++i){
+            perf_event_attr a{};
+            a.size = sizeof a; a.type = PERF_TYPE_HARDWARE; a.config = configs[i];
+            a.disabled = 1; a.exclude_kernel = 1; a.exclude_hv = 1;
+            a.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[i] = int(syscall(SYS_perf_event_open, &a, 0, -1, -1, 0));
+            if (fds[i] < 0 && reason.empty()) reason = std::strerror(errno);
+        }
+#else
+        reason = "perf_event_open is Linux-only";
+#endif
+    }
+    ~PerfCounters(){
+#if defined(__linux__)
+        for (int fd : fds) if (fd >= 0) close(fd);
+#endif
+    }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { for (int fd : fds) if (fd >= 0) return true; return false; }
+    const string& why() const { return reason; }
+
+    void start(){
+#if defined(__linux__)
+        for (int fd : fds) if (fd >= 0){ ioctl(fd, PERF_EVENT_IOC_RESET, 0); ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); }
+#endif
+    }
+    // Counts since start(), scaled up when the kernel multiplexed an event.
+    Values stop(){
+        Values v;
+#if defined(__linux__)
+        for (int fd : fds) if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        for (size_t i = 0; i < kEvents; ++i){
+            uint64_t r[3] = {0, 0, 0}; // value, time enabled, time running
+            if (fds[i] < 0 || read(fds[i], r, sizeof r) != ssize_t(sizeof r) || !r[2]) continue;
+            v[i] = double(r[0]) * double(r[1]) / double(r[2]);
+        }
+#endif
+        return v;
+    }
+
+private:
+    int fds[kEvents] = {-1, -1, -1, -1};
+    string reason;
+};
+
+static int bench(std::vector<string> ctxs, int iters, bool counters, bool allocs){
+    Paths P; P.ensure();
+    Config cfg = loadConfig(P);
+    Workspace ws; // no cache: every iteration resolves from scratch
+    std::map<long long, string> texts;
+    std::vector<std::pair<long long, fs::path>> files;
+    if (ctxs.empty()) files = contextFilesIn(cfg, P.root);
+    for (auto& c : ctxs){
+        string t = (!c.empty() && c[0]==cfg.prefix)? c.substr(1) : c;
+        long long id; if (!parseIntBase(t, cfg.base, id)){ std::cerr<<"Bad context id: "<<c<<"\n"; return 2; }
+        files.push_back({id, contextFileName(cfg, id)});
+    }
+    for (auto& [id, path] : files){
+        std::ifstream in(path, std::ios::binary);
+        if (!in){ std::cerr<<"cannot open "<<path.string()<<"\n"; return 1; }
+        texts[id].assign(std::istreambuf_iterator<char>(in), {});
+    }
+    if (texts.empty()){ std::cerr<<"no banks to benchmark\n"; return 1; }
+    preloadAll(cfg, ws); // resolving must not time file loading
+
+    std::unique_ptr<PerfCounters> perf;
+    if (counters){
+        perf = std::make_unique<PerfCounters>();
+        if (!perf->available()){ std::cerr<<"counters unavailable ("<<perf->why()<<"); wall clock only\n"; perf.reset(); }
+    }
+    size_t sink = 0; // keeps results observable so nothing is optimised away
+    auto run = [&](const char* name, auto&& body){
+        body(); // warm-up
+        PerfCounters::Values sum;
+        resetAllocCounts();
+        allocTracking() = allocs;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < iters; ++i){
+            if (perf) perf->start();
+            body();
+            if (perf){
+                auto v = perf->stop();
+                for (size_t k = 0; k < v.size(); ++k) if (v[k]) sum[k] = sum[k].value_or(0) + *v[k];
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / iters;
+        allocTracking() = false;
+        std::cout<<std::left<<std::setw(9)<<name<<std::right<<std::setw(6)<<iters
+                 <<std::fixed<<std::setprecision(3)<<std::setw(12)<<ms;
+        if (allocs){
+            uint64_t n = 0, bytes = 0;
+            for (size_t k = 0; k < size_t(AllocOp::Count); ++k){ n += allocCounts(AllocOp(k)).count; bytes += allocCounts(AllocOp(k)).bytes; }
+            std::cout<<std::setw(12)<<n / uint64_t(iters)<<std::setw(14)<<bytes / uint64_t(iters);
+        }
+        if (perf){
+            for (auto& v : sum){
+                if (v) std::cout<<std::setprecision(0)<<std::setw(16)<<*v / iters;
+                else std::cout<<std::setw(16)<<"-";
+            }
+            if (sum[0] && sum[1] && *sum[0] > 0) std::cout<<std::setprecision(2)<<std::setw(7)<<*sum[1] / *sum[0];
+        }
+        std::cout<<std::defaultfloat<<"\n";
+    };
+
+    std::cout<<std::left<<std::setw(9)<<"bench"<<std::right<<std::setw(6)<<"iters"<<std::setw(12)<<"ms/iter";
+    if (allocs) std::cout<<std::setw(12)<<"allocs"<<std::setw(14)<<"bytes";
+    if (perf){
+        for (auto* n : PerfCounters::kNames) std::cout<<std::setw(16)<<n;
+        std::cout<<std::setw(7)<<"IPC";
+    }
+    std::cout<<"\n";
+    run("parse", [&]{
+        for (auto& [id, text] : texts){ Bank b; (void)parseBankText(text, cfg, b); sink += b.regs.size(); }
+    });
+    run("resolve", [&]{
+        for (auto& [id, text] : texts){
+            Resolver R(cfg, ws); // fresh memo per bank, as :resolve has
+            for (auto& [rid, addrs] : ws.banks[id].regs)
+                for (auto& [aid, val] : addrs){ std::unordered_set<string> visited; sink += R.resolve(val, id, visited).size(); }
+        }
+    });
+    run("write", [&]{
+        for (auto& [id, text] : texts) sink += writeBankText(ws.banks[id], cfg).size();
+    });
+    run("export", [&]{
+        for (auto& [id, text] : texts) sink += exportBankToJSON(cfg, ws, id).size();
+    });
+    std::cout<<texts.size()<<" banks"<<(sink? "" : " (empty)")<<"\n";
+    return 0;
+}
+
+static int publish(const string& image){
+    Paths P; P.ensure();
+    Config cfg = loadConfig(P);
+    Workspace ws; string err;
+    preloadAll(cfg, ws);
+    fs::path out = image.empty()? P.outdir / "workspace.img" : fs::path(image);
+    if (!publishWorkspace(cfg, ws, out, err)){ std::cerr<<err<<"\n"; return 1; }
+    std::cout<<"Published "<<ws.banks.size()<<" banks to "<<out.string()<<"\n";
+    return 0;
+}
+
+// Whole-number option value no smaller than min; otherwise prints a usage
+// error naming the option and returns false.
+static bool numberArg(const string& opt, const string& v, long long min, long long& out){
+    try {
+        size_t used = 0;
+        out = std::stoll(v, &used);
+        if (used == v.size() && out >= min) return true;
+    } catch(...) {}
+    std::cerr<<opt<<" expects a whole number >= "<<min<<", got '"<<v<<"'\n";
+    return false;
+}
+
+int main(int argc, char** argv){
+    std::vector<string> args(argv + 1, argv + argc);
+    string image;
+    if (args.size()>=2 && args[0]=="--attach"){ image = args[1]; args.erase(args.begin(), args.begin()+2); }
+    if (!args.empty() && args[0]=="--publish") return publish(args.size()>=2? args[1] : "");
+    if (!args.empty() && args[0]=="--resolve-worker" && args.size()>=2){
+        std::vector<long long> ids;
+        std::istringstream is(args[1]);
+        for (string t; std::getline(is, t, ',');){
+            long long id;
+            if (t.empty()) continue;
+            if (!numberArg("--resolve-worker", t, 0, id)) return 2;
+            ids.push_back(id);
+        }
+        return resolveWorker(ids, std::cout, image);
+    }
+    if (!args.empty() && args[0]=="--resolve"){
+        Paths P; Config cfg = loadConfig(P);
+        std::vector<long long> ids;
+        for (size_t i=1; i<args.size(); ++i){
+            string t = (!args[i].empty() && args[i][0]==cfg.prefix)? args[i].substr(1) : args[i];
+            long long id; if (!parseIntBase(t, cfg.base, id)){ std::cerr<<"Bad context id: "<<args[i]<<"\n"; return 2; }
+            ids.push_back(id);
+        }
+        if (ids.empty() && !image.empty()){
+            Workspace probe; string err;
+            if (!attachWorkspace(cfg, probe, image, err)){ std::cerr<<err<<"\n"; return 1; }
+            ids = probe.image->bankIds();
+        }
+        std::ostringstream os;
+        int rc = resolveWorker(ids, os, image);
+        std::istringstream is(os.str());
+        for (string line; std::getline(is, line);) if (line.rfind("fail ", 0)==0) std::cerr<<line<<"\n";
+        return rc;
+    }
+    if (!args.empty() && args[0]=="--resolve-all"){
+        unsigned workers = hardwareThreads();
+        int retries = 2;
+        long long shardK = 0, shardM = 0;
+        for (size_t i=1; i+1<args.size(); i+=2){
+            long long n;
+            if (args[i]=="--workers"){ if (!numberArg("--workers", args[i+1], 1, n)) return 2; workers = unsigned(n); }
+            else if (args[i]=="--retries"){ if (!numberArg("--retries", args[i+1], 0, n)) return 2; retries = int(n); }
+            else if (args[i]=="--shard"){
+                auto slash = args[i+1].find('/');
+                if (slash==string::npos){ std::cerr<<"--shard expects K/M\n"; return 2; }
+                if (!numberArg("--shard K", args[i+1].substr(0, slash), 0, shardK) ||
+                    !numberArg("--shard M", args[i+1].substr(slash+1), 1, shardM)) return 2;
+                if (shardK >= shardM){ std::cerr<<"--shard expects K < M\n"; return 2; }
+            }
+        }
+        const char* self = kLinux && fs::exists("/proc/self/exe")? "/proc/self/exe" : argv[0];
+        return resolveAll(workers, retries, shardK, shardM, self, image);
+    }
+    if (!args.empty() && args[0]=="--bench"){
+        std::vector<string> ctxs;
+        int iters = 5;
+        bool counters = false, allocs = false;
+        for (size_t i=1; i<args.size(); ++i){
+            if (args[i]=="--iters" && i+1<args.size()){
+                long long n;
+                if (!numberArg("--iters", args[++i], 1, n)) return 2;
+                iters = int(std::min<long long>(n, std::numeric_limits<int>::max()));
+            }
+            else if (args[i]=="--counters") counters = true;
+            else if (args[i]=="--allocs") allocs = true;
+            else ctxs.push_back(args[i]);
+        }
+        return bench(ctxs, iters, counters, allocs);
+    }
+    if (!args.empty() && args[0]=="--watch"){
+        unsigned workers = hardwareThreads();
+        int debounceMs = 300;
+        for (size_t i=1; i+1<args.size(); i+=2){
+            long long n;
+            if (args[i]=="--workers"){ if (!numberArg("--workers", args[i+1], 1, n)) return 2; workers = unsigned(n); }
+            else if (args[i]=="--debounce"){
+                if (!numberArg("--debounce", args[i+1], 0, n)) return 2;
+                debounceMs = int(std::clamp<long long>(n, 10, 60000));
+            }
+        }
+        const char* self = kLinux && fs::exists("/proc/self/exe")? "/proc/self/exe" : argv[0];
+        return watchFiles(workers, debounceMs, self, image);
+    }
     Editor ed;
     ed.repl();
     return 0;
@@ -6,7 +6,9 @@
 #include <string>
 #include <string_view>
 #include <vector>
+#include <array>
 #include <map>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 #include <regex>
@@ -18,6 +20,24 @@
 #include <cctype>
 #include <limits>
 #include <optional>
+#include <thread>
+#include <iterator>
+#include <tuple>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <atomic>
+#include <random>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
 
 namespace scripted {
 
@@ -94,6 +114,86 @@ inline string toBaseN(long long val, int base, int width){
     return s;
 }
 
+// ----------------------------- Allocation tracking -----------------------------
+// Counters fed by replacement operator new (a program opts in by defining it,
+// as scripted.cpp does, and by switching allocTracking() on). Each allocation
+// is charged to the innermost AllocScope on its thread; parallelFor carries
+// the scope into its worker threads.
+enum class AllocOp { Load, Parse, Resolve, Export, Other, Count };
+inline const char* allocOpName(AllocOp op){
+    static const char* names[] = {"load", "parse", "resolve", "export", "other"};
+    return names[size_t(op)];
+}
+struct AllocCounts { std::atomic<uint64_t> count{0}, bytes{0}; };
+inline std::atomic<bool>& allocTracking(){ static std::atomic<bool> on{false}; return on; }
+inline AllocCounts& allocCounts(AllocOp op){ static AllocCounts c[size_t(AllocOp::Count)]; return c[size_t(op)]; }
+inline thread_local AllocOp allocCurrent = AllocOp::Other;
+inline void noteAlloc(size_t n){
+    if (!allocTracking().load(std::memory_order_relaxed)) return;
+    auto& c = allocCounts(allocCurrent);
+    c.count.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(n, std::memory_order_relaxed);
+}
+inline void resetAllocCounts(){
+    for (size_t i = 0; i < size_t(AllocOp::Count); ++i){ allocCounts(AllocOp(i)).count = 0; allocCounts(AllocOp(i)).bytes = 0; }
+}
+struct AllocScope {
+    AllocOp prev;
+    explicit AllocScope(AllocOp op): prev(allocCurrent) { allocCurrent = op; }
+    ~AllocScope(){ allocCurrent = prev; }
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+};
+
+// ----------------------------- Parallel helpers -----------------------------
+inline unsigned hardwareThreads(){
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// Runs f(begin, end) over [0, n) split into at most hardwareThreads() chunks
+// of at least minChunk items; small inputs stay on the calling thread.
+template<class F>
+void parallelFor(size_t n, F&& f, size_t minChunk = 1024){
+    size_t chunks = std::min<size_t>(hardwareThreads(), (n + minChunk - 1) / std::max<size_t>(minChunk, 1));
+    if (chunks <= 1){ if (n) f(size_t(0), n); return; }
+    std::vector<std::thread> pool;
+    pool.reserve(chunks - 1);
+    const size_t step = (n + chunks - 1) / chunks;
+    const AllocOp scope = allocCurrent;
+    for (size_t c = 1; c < chunks; ++c){
+        size_t b = c*step, e = std::min(n, b + step);
+        if (b < e) pool.emplace_back([&f, b, e, scope]{ AllocScope s(scope); f(b, e); });
+    }
+    f(size_t(0), std::min(n, step));
+    for (auto& t : pool) t.join();
+}
+
+// std::sort per chunk in parallel, then pairwise in-place merges (each level
+// in parallel). Below serialBelow elements it is just std::sort.
+template<class It, class Cmp>
+void parallelSort(It first, It last, Cmp cmp, size_t serialBelow = size_t(1) << 15){
+    const size_t n = size_t(std::distance(first, last));
+    size_t chunks = std::min<size_t>(hardwareThreads(), n / std::max<size_t>(serialBelow, 1));
+    if (chunks <= 1){ std::sort(first, last, cmp); return; }
+    std::vector<size_t> bounds;
+    for (size_t c = 0; c <= chunks; ++c) bounds.push_back(n * c / chunks);
+    parallelFor(chunks, [&](size_t b, size_t e){
+        for (size_t c = b; c < e; ++c) std::sort(first + bounds[c], first + bounds[c+1], cmp);
+    }, 1);
+    while (bounds.size() > 2){
+        std::vector<size_t> next;
+        const size_t pairs = (bounds.size() - 1) / 2;
+        parallelFor(pairs, [&](size_t b, size_t e){
+            for (size_t p = b; p < e; ++p)
+                std::inplace_merge(first + bounds[2*p], first + bounds[2*p+1], first + bounds[2*p+2], cmp);
+        }, 1);
+        for (size_t i = 0; i < bounds.size(); i += 2) next.push_back(bounds[i]);
+        if (next.back() != bounds.back()) next.push_back(bounds.back());
+        bounds.swap(next);
+    }
+}
+
 // ----------------------------- Config/Paths/Model -----------------------------
 struct Config {
     char prefix = 'x';
@@ -101,6 +201,7 @@ struct Config {
     int  widthBank = 5;
     int  widthReg  = 2;
     int  widthAddr = 4;
+    int  autosave  = 0;   // seconds between background saves of dirty banks; 0 = off
 
     string toJSON() const {
         std::ostringstream os;
@@ -109,7 +210,8 @@ struct Config {
         os << "  \"base\": " << base << ",\n";
         os << "  \"widthBank\": " << widthBank << ",\n";
         os << "  \"widthReg\": " << widthReg << ",\n";
-        os << "  \"widthAddr\": " << widthAddr << "\n";
+        os << "  \"widthAddr\": " << widthAddr << ",\n";
+        os << "  \"autosave\": " << autosave << "\n";
         os << "}\n";
         return os.str();
     }
@@ -138,6 +240,7 @@ struct Config {
         c.widthBank  = getInt("widthBank", 5);
         c.widthReg   = getInt("widthReg", 2);
         c.widthAddr  = getInt("widthAddr", 4);
+        c.autosave   = getInt("autosave", 0);
         return c;
     }
 };
@@ -146,6 +249,7 @@ struct Paths {
     fs::path root   = "files";
     fs::path outdir = root / "out";
     fs::path config = root / "config.json";
+    fs::path cache  = root / ".cache";   // resolved-value cache, see ResolveCache
     void ensure() const {
         fs::create_directories(root);
         fs::create_directories(outdir);
@@ -164,15 +268,595 @@ struct Bank {
     }
 };
 
+// ----------------------------- Bloom filters -----------------------------
+// Per-bank filter over (reg, addr). A negative answer is definite, so
+// references to cells that do not exist skip the exact lookup. About 10 bits
+// per cell and 6 probes give roughly 1% false positives. test() works on raw
+// words so a filter mapped from a workspace image is used in place.
+struct BankBloom {
+    static constexpr unsigned kProbes = 6;
+    std::vector<uint64_t> words; // power-of-two count; empty = "maybe" for everything
+    unsigned long long rev = 0;  // bank revision the filter describes; see Workspace::bloom
+
+    static uint64_t hash(long long reg, long long addr){
+        uint64_t x = uint64_t(reg) * 0x9E3779B97F4A7C15ull ^ uint64_t(addr);
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+    static bool test(const uint64_t* w, size_t n, long long reg, long long addr){
+        if (n == 0) return true;
+        const uint64_t h = hash(reg, addr), step = (h >> 32) | 1, mask = n*64 - 1;
+        for (unsigned i = 0; i < kProbes; ++i){
+            uint64_t bit = (h + i*step) & mask;
+            if (!(w[bit >> 6] >> (bit & 63) & 1)) return false;
+        }
+        return true;
+    }
+    bool mayContain(long long reg, long long addr) const { return test(words.data(), words.size(), reg, addr); }
+    void add(long long reg, long long addr){
+        if (words.empty()) return;
+        const uint64_t h = hash(reg, addr), step = (h >> 32) | 1, mask = words.size()*64 - 1;
+        for (unsigned i = 0; i < kProbes; ++i){
+            uint64_t bit = (h + i*step) & mask;
+            words[bit >> 6] |= uint64_t(1) << (bit & 63);
+        }
+    }
+    static BankBloom build(const Bank& b){
+        size_t cells = 0;
+        for (auto& [rid, addrs] : b.regs) cells += addrs.size();
+        BankBloom f;
+        size_t n = 1;
+        while (n*64 < cells*10) n <<= 1;
+        f.words.assign(n, 0);
+        for (auto& [rid, addrs] : b.regs)
+            for (auto& [aid, val] : addrs) f.add(rid, aid);
+        return f;
+    }
+};
+
+// ----------------------------- Shared workspace image -----------------------------
+// An immutable, already-parsed workspace in one file that many processes map
+// read-only (POSIX mmap; on Windows the file is read into memory instead).
+// Layout: ImageHeader, ImageBank[banks] sorted by id, ImageCell[cells] sorted
+// by (reg, addr) within each bank, each bank's Bloom filter words, then one
+// blob holding titles and values.
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t base;
+    char prefix, pad[7];
+    uint64_t banks, cells, bankOff, cellOff, strOff, strSize;
+};
+struct ImageBank { int64_t id; uint64_t firstCell, cellCount, titleOff, titleLen, bloomOff, bloomWords; };
+struct ImageCell { int64_t reg, addr; uint64_t valOff, valLen; };
+inline constexpr char kImageMagic[8] = {'S','C','R','I','M','G','1','\0'};
+inline constexpr uint32_t kImageVersion = 2;
+
+// A whole file, read-only: mapped where the platform allows, else read in.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile(){
+#if !defined(_WIN32)
+        if (mapped) munmap(const_cast<char*>(base), len);
+#endif
+    }
+    bool open(const fs::path& path, string& err){
+#if defined(_WIN32)
+        std::ifstream in(path, std::ios::binary);
+        if (!in){ err = "cannot open " + path.string(); return false; }
+        heap.assign(std::istreambuf_iterator<char>(in), {});
+        if (heap.empty()){ err = "empty file " + path.string(); return false; }
+        base = heap.data(); len = heap.size();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0){ err = "cannot open " + path.string(); return false; }
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || st.st_size <= 0){ ::close(fd); err = "cannot stat " + path.string(); return false; }
+        void* m = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (m == MAP_FAILED){ err = "cannot map " + path.string(); return false; }
+        base = static_cast<const char*>(m); len = size_t(st.st_size); mapped = true;
+#endif
+        return true;
+    }
+    const char* data() const { return base; }
+    size_t size() const { return len; }
+
+private:
+    const char* base = nullptr;
+    size_t len = 0;
+    bool mapped = false;
+    std::vector<char> heap;
+};
+
+class WorkspaceImage {
+public:
+    static std::shared_ptr<const WorkspaceImage> open(const fs::path& path, string& err){
+        std::shared_ptr<WorkspaceImage> img(new WorkspaceImage);
+        if (!img->file.open(path, err)) return nullptr;
+        img->base = img->file.data(); img->size = img->file.size();
+        if (!img->validate(err)) return nullptr;
+        return img;
+    }
+    WorkspaceImage(const WorkspaceImage&) = delete;
+    WorkspaceImage& operator=(const WorkspaceImage&) = delete;
+
+    char prefix() const { return hdr->prefix; }
+    int numberBase() const { return hdr->base; }
+    size_t bankCount() const { return size_t(hdr->banks); }
+    size_t cellCount() const { return size_t(hdr->cells); }
+    bool hasBank(long long id) const { return findBank(id) != nullptr; }
+
+    std::optional<std::string_view> find(long long bank, long long reg, long long addr) const {
+        const ImageBank* b = findBank(bank);
+        if (!b || !BankBloom::test(bloom(*b), size_t(b->bloomWords), reg, addr)) return std::nullopt;
+        const ImageCell* first = cells + b->firstCell, *last = first + b->cellCount;
+        auto it = std::lower_bound(first, last, std::pair(reg, addr), [](const ImageCell& c, const std::pair<long long,long long>& k){
+            return std::pair<long long,long long>(c.reg, c.addr) < k;
+        });
+        if (it == last || it->reg != reg || it->addr != addr) return std::nullopt;
+        return text(it->valOff, it->valLen);
+    }
+
+    // Private copy of one bank, for code that needs a mutable Bank.
+    bool bank(long long id, Bank& out) const {
+        const ImageBank* b = findBank(id);
+        if (!b) return false;
+        out = {};
+        out.id = id;
+        out.title = string(text(b->titleOff, b->titleLen));
+        for (uint64_t i = 0; i < b->cellCount; ++i){
+            const ImageCell& c = cells[b->firstCell + i];
+            out.regs[c.reg].emplace_hint(out.regs[c.reg].end(), c.addr, string(text(c.valOff, c.valLen)));
+        }
+        return true;
+    }
+
+    // In-place walk of one bank, as FrozenBank::forEach: reg(id) once per
+    // register, then cell(reg, addr, value) for each of its cells.
+    template<class Reg, class CellFn> void forEach(long long id, Reg&& reg, CellFn&& cell) const {
+        const ImageBank* b = findBank(id);
+        if (!b) return;
+        for (uint64_t i = 0; i < b->cellCount; ++i){
+            const ImageCell& c = cells[b->firstCell + i];
+            if (i == 0 || c.reg != cells[b->firstCell + i - 1].reg) reg((long long)c.reg);
+            cell((long long)c.reg, (long long)c.addr, text(c.valOff, c.valLen));
+        }
+    }
+    size_t registers(long long id) const {
+        size_t n = 0;
+        forEach(id, [&](long long){ ++n; }, [](long long, long long, std::string_view){});
+        return n;
+    }
+    string title(long long id) const {
+        const ImageBank* b = findBank(id);
+        return b? string(text(b->titleOff, b->titleLen)) : string();
+    }
+
+    std::vector<long long> bankIds() const {
+        std::vector<long long> ids;
+        for (uint64_t i = 0; i < hdr->banks; ++i) ids.push_back(banks[i].id);
+        return ids;
+    }
+
+private:
+    WorkspaceImage() = default;
+    MappedFile file;
+    const char* base = nullptr;
+    size_t size = 0;
+    const ImageHeader* hdr = nullptr;
+    const ImageBank* banks = nullptr;
+    const ImageCell* cells = nullptr;
+    const char* strings = nullptr;
+
+    bool validate(string& err){
+        auto fits = [&](uint64_t off, uint64_t n, uint64_t each){
+            return off <= size && n <= (size - off) / each;
+        };
+        if (size < sizeof(ImageHeader) || std::memcmp(base, kImageMagic, sizeof kImageMagic) != 0){ err = "not a workspace image"; return false; }
+        hdr = reinterpret_cast<const ImageHeader*>(base);
+        if (hdr->version != kImageVersion){ err = "unsupported image version (publish it again)"; return false; }
+        if (!fits(hdr->bankOff, hdr->banks, sizeof(ImageBank)) || !fits(hdr->cellOff, hdr->cells, sizeof(ImageCell)) ||
+            !fits(hdr->strOff, hdr->strSize, 1)){ err = "truncated workspace image"; return false; }
+        banks = reinterpret_cast<const ImageBank*>(base + hdr->bankOff);
+        cells = reinterpret_cast<const ImageCell*>(base + hdr->cellOff);
+        strings = base + hdr->strOff;
+        for (uint64_t i = 0; i < hdr->banks; ++i)
+            if (banks[i].firstCell > hdr->cells || banks[i].cellCount > hdr->cells - banks[i].firstCell ||
+                banks[i].bloomOff % 8 || !fits(banks[i].bloomOff, banks[i].bloomWords, 8) ||
+                (banks[i].bloomWords & (banks[i].bloomWords - 1))){ err = "corrupt bank table"; return false; }
+        return true;
+    }
+    const ImageBank* findBank(long long id) const {
+        const ImageBank* last = banks + hdr->banks;
+        auto it = std::lower_bound(banks, last, id, [](const ImageBank& b, long long k){ return b.id < k; });
+        return (it != last && it->id == id)? it : nullptr;
+    }
+    const uint64_t* bloom(const ImageBank& b) const { return reinterpret_cast<const uint64_t*>(base + b.bloomOff); }
+    std::string_view text(uint64_t off, uint64_t len) const {
+        if (off > hdr->strSize || len > hdr->strSize - off) return {};
+        return std::string_view(strings + off, size_t(len));
+    }
+};
+
+// ----------------------------- Value interning -----------------------------
+// Append-only store of immutable values: identical text is kept once and every
+// holder gets a view of the same bytes. Views stay valid for the life of the
+// pool, so holders keep it alive through a shared_ptr. Nothing is ever written
+// through a view; editing a bank thaws it and the edit gets its own string.
+struct InternStats {
+    size_t values = 0, bytes = 0;       // everything interned / scanned
+    size_t unique = 0, uniqueBytes = 0; // what is actually stored
+    double ratio() const { return uniqueBytes? double(bytes) / double(uniqueBytes) : 1.0; }
+};
+
+class InternPool {
+public:
+    std::string_view intern(std::string_view v){
+        std::lock_guard<std::mutex> lk(mu);
+        ++st.values; st.bytes += v.size();
+        if (auto it = index.find(v); it != index.end()) return *it;
+        std::string_view kept = store(v);
+        index.insert(kept);
+        ++st.unique; st.uniqueBytes += v.size();
+        return kept;
+    }
+    InternStats stats() const { std::lock_guard<std::mutex> lk(mu); return st; }
+
+private:
+    static constexpr size_t kChunk = 64 * 1024;
+    mutable std::mutex mu;
+    std::unordered_set<std::string_view> index;
+    std::vector<std::unique_ptr<char[]>> chunks, large;
+    size_t used = kChunk; // bytes used in chunks.back()
+    InternStats st;
+
+    std::string_view store(std::string_view v){
+        if (v.empty()) return {};
+        char* p;
+        if (v.size() > kChunk / 4){ // large values get a block of their own
+            large.push_back(std::make_unique<char[]>(v.size()));
+            p = large.back().get();
+        } else {
+            if (used + v.size() > kChunk){ chunks.push_back(std::make_unique<char[]>(kChunk)); used = 0; }
+            p = chunks.back().get() + used;
+            used += v.size();
+        }
+        std::memcpy(p, v.data(), v.size());
+        return {p, v.size()};
+    }
+};
+
+// What interning every value of the loaded banks would store.
+inline InternStats dedupStats(const std::map<long long, Bank>& banks){
+    InternStats st;
+    std::unordered_set<std::string_view> seen;
+    for (auto& [id, b] : banks)
+        for (auto& [rid, addrs] : b.regs)
+            for (auto& [aid, val] : addrs){
+                ++st.values; st.bytes += val.size();
+                if (seen.insert(val).second){ ++st.unique; st.uniqueBytes += val.size(); }
+            }
+    return st;
+}
+
+// ----------------------------- Frozen banks -----------------------------
+// Read-optimised copy of a bank that is not being edited: values live in one
+// blob and (reg, addr) maps to a slot in O(1). Registers whose addresses are
+// nearly contiguous use a direct index table; the rest share a perfect hash
+// built by hash-and-displace (a per-bucket seed picks free slots for every
+// key in the bucket). Freezing copies the values into an intern pool (a
+// private one unless the workspace shares one), so the source bank may be
+// edited or replaced afterwards; the workspace drops the frozen copy then.
+//
+// Cells are 24 bytes: 32-bit reg and addr, and the value inline when it is
+// at most kSmall bytes, else a pointer into the pool. Banks whose ids do not
+// fit in 32 bits (wide configured widths) are not frozen: build() returns null.
+class FrozenBank {
+public:
+    static std::shared_ptr<const FrozenBank> build(const Bank& b, std::shared_ptr<InternPool> pool = nullptr){
+        size_t total = 0;
+        for (auto& [rid, addrs] : b.regs){
+            if (!fits(rid)) return nullptr;
+            if (!addrs.empty() && (!fits(addrs.begin()->first) || !fits(addrs.rbegin()->first))) return nullptr;
+            total += addrs.size();
+        }
+        if (total >= UINT32_MAX) return nullptr;
+        std::shared_ptr<FrozenBank> f(new FrozenBank);
+        f->pool = pool? std::move(pool) : std::make_shared<InternPool>();
+        std::vector<std::pair<long long,long long>> hashed;
+        f->cells.reserve(total);
+        for (auto& [rid, addrs] : b.regs){
+            f->regs.push_back({uint32_t(rid), uint32_t(f->cells.size()), uint32_t(addrs.size())});
+            if (addrs.empty()) continue;
+            const long long lo = addrs.begin()->first, span = addrs.rbegin()->first - lo + 1;
+            const bool dense = span > 0 && size_t(span) <= 2*addrs.size() + 16;
+            if (dense) f->dense.push_back({uint32_t(rid), uint32_t(lo), std::vector<uint32_t>(size_t(span), 0)});
+            for (auto& [aid, val] : addrs){
+                f->cells.push_back(f->makeCell(rid, aid, val));
+                if (dense) f->dense.back().slot[size_t(aid - lo)] = uint32_t(f->cells.size()); // 1-based
+                else hashed.push_back({rid, aid});
+            }
+        }
+        f->buildHash(hashed);
+        return f;
+    }
+
+    // Calls reg(id) for every register (empty ones too), then cell(reg, addr,
+    // value) for each of its cells, in bank order.
+    template<class Reg, class CellFn> void forEach(Reg&& reg, CellFn&& cell) const {
+        for (auto& r : regs){
+            reg((long long)r.id);
+            for (uint32_t i = r.first; i < r.first + r.count; ++i)
+                cell((long long)cells[i].reg, (long long)cells[i].addr, text(cells[i]));
+        }
+    }
+    size_t registers() const { return regs.size(); }
+
+    bool find(long long reg, long long addr, std::string_view& out) const {
+        if (!fits(reg) || !fits(addr)) return false;
+        auto d = std::lower_bound(dense.begin(), dense.end(), reg, [](const Dense& x, long long r){ return x.reg < r; });
+        if (d != dense.end() && d->reg == reg){
+            if (addr < d->lo || addr - d->lo >= (long long)d->slot.size()) return false;
+            uint32_t i = d->slot[size_t(addr - d->lo)];
+            if (!i) return false;
+            out = text(cells[i-1]); return true;
+        }
+        if (table.empty()) return false;
+        const uint64_t k = key(reg, addr);
+        const uint32_t seed = seeds[mix(k, 0) % seeds.size()];
+        const uint32_t i = table[mix(k, seed) % table.size()];
+        if (!i || cells[i-1].reg != reg || cells[i-1].addr != addr) return false;
+        out = text(cells[i-1]); return true;
+    }
+
+    size_t size() const { return cells.size(); }
+
+private:
+    FrozenBank() = default;
+    static constexpr uint32_t kSmall = 12;
+    struct Cell {
+        uint32_t reg, addr, len;
+        char small[kSmall]; // the value, or a const char* into the pool when len > kSmall
+    };
+    struct Reg { uint32_t id, first, count; };
+    struct Dense { uint32_t reg, lo; std::vector<uint32_t> slot; };
+    std::vector<Cell> cells;
+    std::vector<Reg> regs;            // bank order, empty registers included
+    std::shared_ptr<InternPool> pool; // owns the bytes of values longer than kSmall
+    std::vector<Dense> dense;     // sorted by reg
+    std::vector<uint32_t> seeds;  // per bucket displacement
+    std::vector<uint32_t> table;  // 1-based cell index, 0 = empty
+
+    static bool fits(long long v){ return v >= 0 && v <= (long long)UINT32_MAX; }
+    Cell makeCell(long long reg, long long addr, const string& val) const {
+        Cell c{uint32_t(reg), uint32_t(addr), uint32_t(val.size()), {}};
+        if (val.size() <= kSmall) std::memcpy(c.small, val.data(), val.size());
+        else { const char* p = pool->intern(val).data(); std::memcpy(c.small, &p, sizeof p); }
+        return c;
+    }
+    static std::string_view text(const Cell& c){
+        if (c.len <= kSmall) return {c.small, c.len};
+        const char* p; std::memcpy(&p, c.small, sizeof p);
+        return {p, c.len};
+    }
+    static uint64_t key(long long reg, long long addr){ return uint64_t(reg) * 0x9E3779B97F4A7C15ull ^ uint64_t(addr); }
+    static uint64_t mix(uint64_t x, uint32_t seed){  // splitmix64 finaliser
+        x += 0x9E3779B97F4A7C15ull * (uint64_t(seed) + 1);
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    void buildHash(const std::vector<std::pair<long long,long long>>& keys){
+        if (keys.empty()) return;
+        std::unordered_map<uint64_t, uint32_t> cellOf; // key -> 1-based cell index
+        cellOf.reserve(keys.size());
+        for (size_t i = 0; i < cells.size(); ++i) cellOf[key(cells[i].reg, cells[i].addr)] = uint32_t(i + 1);
+        // Start near-minimal (~6% spare slots keeps the last, single-key buckets
+        // cheap to place); widen by 10% if a bucket still cannot be placed.
+        for (size_t slots = keys.size() + keys.size()/16 + 1; ; slots += slots/10 + 1){
+            const size_t nb = keys.size()/4 + 1;
+            std::vector<std::vector<uint64_t>> buckets(nb);
+            for (auto& [r, a] : keys){ uint64_t k = key(r, a); buckets[mix(k, 0) % nb].push_back(k); }
+            std::vector<size_t> order(nb);
+            for (size_t i = 0; i < nb; ++i) order[i] = i;
+            std::sort(order.begin(), order.end(), [&](size_t x, size_t y){ return buckets[x].size() > buckets[y].size(); });
+            seeds.assign(nb, 0);
+            table.assign(slots, 0);
+            bool ok = true;
+            std::vector<size_t> pos;
+            for (size_t bi : order){
+                auto& bk = buckets[bi];
+                if (bk.empty()) break;
+                bool placed = false;
+                for (uint32_t seed = 1; seed < 4096 && !placed; ++seed){
+                    pos.clear();
+                    placed = true;
+                    for (uint64_t k : bk){
+                        size_t p = mix(k, seed) % slots;
+                        if (table[p] || std::find(pos.begin(), pos.end(), p) != pos.end()){ placed = false; break; }
+                        pos.push_back(p);
+                    }
+                    if (placed){
+                        seeds[bi] = seed;
+                        for (size_t j = 0; j < bk.size(); ++j) table[pos[j]] = cellOf[bk[j]];
+                    }
+                }
+                if (!placed){ ok = false; break; }
+            }
+            if (ok) return;
+        }
+    }
+};
+
 struct Workspace {
+    std::shared_ptr<const WorkspaceImage> image; // read-only fallback for banks not in `banks`
     std::map<long long, Bank> banks;       // id -> Bank
     std::map<long long, string> filenames; // id -> path
+    std::map<long long, unsigned long long> revisions; // id -> edit counter
+
+    // Read-only copies of banks that are not being edited; see freeze().
+    std::unordered_map<long long, std::shared_ptr<const FrozenBank>> frozen;
+    bool autoFreeze = false; // freeze banks as they are loaded (batch resolves)
+    std::shared_ptr<InternPool> intern; // when set, frozen banks share values through it
+    fs::path cacheDir;  // when set, resolved cells persist here between runs; see ResolveCache
+    size_t cacheHits = 0, cacheMisses = 0;
+
+    // Membership filters for loaded banks; a bank without a current one is looked up exactly.
+    std::unordered_map<long long, BankBloom> blooms;
+
+    // Register digests for diffs: (bank, reg) -> (generation, digest); see diffBanks.
+    std::map<std::pair<long long,long long>, std::pair<unsigned long long, unsigned long long>> digests;
+    // Revision of the last whole-bank touch, and of the last touchCell per register.
+    std::unordered_map<long long, unsigned long long> bankTouched;
+    std::map<std::pair<long long,long long>, unsigned long long> regTouched;
+
+    // Call after mutating banks[id]; lets snapshots/caches tell stale from fresh.
+    void touch(long long id){ bankTouched[id] = ++revisions[id]; frozen.erase(id); blooms.erase(id); forgetDigests(id); }
+    // Cheaper touch for a single inserted or overwritten cell: keeps the filter.
+    void touchCell(long long id, long long reg, long long addr){
+        const auto before = revisions[id]++;
+        frozen.erase(id);
+        if (auto it = blooms.find(id); it != blooms.end() && it->second.rev == before){
+            it->second.add(reg, addr);
+            it->second.rev = before + 1;
+        }
+        regTouched[{id, reg}] = before + 1;
+        digests.erase({id, reg});
+    }
+    void forgetDigests(long long id){
+        const std::pair<long long,long long> first{id, std::numeric_limits<long long>::min()};
+        auto it = digests.lower_bound(first);
+        while (it != digests.end() && it->first.first == id) it = digests.erase(it);
+        auto r = regTouched.lower_bound(first); // the bank's own touch now covers them
+        while (r != regTouched.end() && r->first.first == id) r = regTouched.erase(r);
+    }
+    // Changes whenever register reg of bank id may have: touchCell on that
+    // register or touch on the bank. Edits to other registers leave it alone.
+    unsigned long long generation(long long id, long long reg) const {
+        auto b = bankTouched.find(id);
+        auto r = regTouched.find({id, reg});
+        return std::max(b == bankTouched.end()? 0 : b->second, r == regTouched.end()? 0 : r->second);
+    }
+    void buildBloom(long long id){
+        auto it = banks.find(id);
+        if (it == banks.end()) return;
+        auto& f = blooms[id] = BankBloom::build(it->second);
+        f.rev = revision(id);
+    }
+    // The filter for id, or nullptr unless it was built (or kept up by touchCell)
+    // at the bank's current revision: an edit that skipped touch must not hide cells.
+    const BankBloom* bloom(long long id) const {
+        auto it = blooms.find(id);
+        return it != blooms.end() && it->second.rev == revision(id)? &it->second : nullptr;
+    }
+    void freeze(long long id){
+        auto it = banks.find(id);
+        if (it == banks.end()) return;
+        if (auto f = FrozenBank::build(it->second, intern)) frozen[id] = std::move(f);
+    }
+    unsigned long long revision(long long id) const {
+        auto it = revisions.find(id);
+        return it==revisions.end()? 0 : it->second;
+    }
+};
+
+// An overlay is a writable layer of cell edits over a workspace that stays
+// read-only underneath, so several what-if layers can share one loaded base.
+// Only edited cells are stored; std::nullopt records a deletion.
+struct Overlay {
+    using Cell = std::optional<string>;
+    std::map<long long, std::map<std::pair<long long,long long>, Cell>> cells; // bank -> (reg,addr)
+
+    void set(long long bank, long long reg, long long addr, string v){ cells[bank][{reg,addr}] = std::move(v); }
+    void erase(long long bank, long long reg, long long addr){ cells[bank][{reg,addr}] = std::nullopt; }
+    const Cell* find(long long bank, long long reg, long long addr) const {
+        auto itB = cells.find(bank);
+        if (itB==cells.end()) return nullptr;
+        auto it = itB->second.find({reg,addr});
+        return it==itB->second.end()? nullptr : &it->second;
+    }
+    size_t size() const { size_t n=0; for (auto& [b,m] : cells) n += m.size(); return n; }
+    bool empty() const { return cells.empty(); }
 };
 
+// Reads one cell through an optional overlay.
+inline bool lookupCell(const Workspace& ws, const Overlay* ov, long long bank, long long reg, long long addr, string& out){
+    if (ov) if (auto c = ov->find(bank, reg, addr)){
+        if (!*c) return false;
+        out = **c; return true;
+    }
+    if (auto f = ws.frozen.find(bank); f != ws.frozen.end()){
+        std::string_view v;
+        if (!f->second->find(reg, addr, v)) return false;
+        out.assign(v); return true;
+    }
+    auto itB = ws.banks.find(bank);
+    if (auto f = ws.bloom(bank); f && itB != ws.banks.end() && !f->mayContain(reg, addr))
+        return false;
+    if (itB==ws.banks.end()){
+        if (!ws.image) return false;
+        auto v = ws.image->find(bank, reg, addr);
+        if (!v) return false;
+        out.assign(*v); return true;
+    }
+    auto itR = itB->second.regs.find(reg);
+    if (itR==itB->second.regs.end()) return false;
+    auto itA = itR->second.find(addr);
+    if (itA==itR->second.end()) return false;
+    out = itA->second;
+    return true;
+}
+
+// Copy of bankId as seen through the overlay.
+inline Bank overlaidBank(const Workspace& ws, const Overlay& ov, long long bankId){
+    Bank b;
+    if (auto it = ws.banks.find(bankId); it != ws.banks.end()) b = it->second;
+    b.id = bankId;
+    auto itO = ov.cells.find(bankId);
+    if (itO==ov.cells.end()) return b;
+    for (auto& [key, cell] : itO->second){
+        auto [reg, addr] = key;
+        if (cell) { b.regs[reg][addr] = *cell; continue; }
+        auto itR = b.regs.find(reg);
+        if (itR==b.regs.end()) continue;
+        itR->second.erase(addr);
+        if (itR->second.empty()) b.regs.erase(itR);
+    }
+    return b;
+}
+
+// Applies the overlay to ws and empties it. Banks it changes are touched.
+// Returns the number of cells written or deleted.
+inline size_t commitOverlay(Workspace& ws, Overlay& ov){
+    size_t n = 0;
+    for (auto& [bankId, edits] : ov.cells){
+        auto& b = ws.banks[bankId];
+        b.id = bankId;
+        for (auto& [key, cell] : edits){
+            auto [reg, addr] = key;
+            if (cell) { b.regs[reg][addr] = std::move(*cell); ++n; continue; }
+            auto itR = b.regs.find(reg);
+            if (itR==b.regs.end() || !itR->second.erase(addr)) continue;
+            ++n;
+            if (itR->second.empty()) b.regs.erase(itR);
+        }
+        ws.touch(bankId);
+    }
+    ov.cells.clear();
+    return n;
+}
+
 // ----------------------------- Parsing & I/O -----------------------------
 struct ParseResult { bool ok=true; string err; };
 
 inline ParseResult parseBankText(const string& text, const Config& cfg, Bank& outBank) {
+    AllocScope scope(AllocOp::Parse);
     std::vector<string> lines;
     {
         std::istringstream is(text);
@@ -276,7 +960,22 @@ inline fs::path outJsonName(const Config& cfg, long long bankId){
     return fs::path("files/out") / (string(1,cfg.prefix) + toBaseN(bankId, cfg.base, cfg.widthBank) + ".json");
 }
 
+// Temp file beside path for a write-then-rename: unique per call, so
+// concurrent writers of one target never share it.
+inline fs::path uniqueTempPath(const fs::path& path){
+    static std::atomic<unsigned> seq{0};
+    fs::path tmp = path; tmp += ".tmp" + std::to_string(std::random_device{}()) + "." + std::to_string(seq++);
+    return tmp;
+}
+// Whether p names such a temp file (a write in flight): "<name>.tmp<digits>.<digits>".
+inline bool isTempName(const fs::path& p){
+    const string n = p.filename().string();
+    const auto at = n.rfind(".tmp");
+    return at != string::npos && n.find_first_not_of("0123456789.", at + 4) == string::npos;
+}
+
 inline bool loadContextFile(const Config& cfg, const fs::path& file, Bank& bank, string& err){
+    AllocScope scope(AllocOp::Load);
     if (!fs::exists(file)) { err = "file not found: " + file.string(); return false; }
     std::ifstream in(file, std::ios::binary);
     if (!in){ err="cannot open: " + file.string(); return false; }
@@ -294,14 +993,19 @@ inline bool saveContextFile(const Config& cfg,
     try {
         std::filesystem::create_directories(path.parent_path());
 
-        // Write to a temp file first
-        auto tmp = path; tmp += ".tmp";
+        // Write to a temp file first; unique per write, so concurrent saves
+        // of one bank never share it
+        auto tmp = uniqueTempPath(path);
         {
             std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
             if (!out) { err = "Cannot open temp file for write: " + tmp.string(); return false; }
             std::string text = writeBankText(b, cfg);
             out.write(text.data(), (std::streamsize)text.size());
-            if (!out) { err = "Write failed: " + tmp.string(); return false; }
+            if (!out) {
+                err = "Write failed: " + tmp.string();
+                out.close(); std::error_code rmEc; std::filesystem::remove(tmp, rmEc);
+                return false;
+            }
         }
 
         // Replace the target (works across volumes with fallback)
@@ -323,121 +1027,397 @@ inline bool saveContextFile(const Config& cfg,
 
 inline bool ensureBankLoadedInWorkspace(const Config& cfg, Workspace& ws, long long bankId, string& err){
     if (ws.banks.count(bankId)) return true;
+    if (Bank fromImage; ws.image && ws.image->bank(bankId, fromImage)){
+        ws.banks[bankId] = std::move(fromImage);
+        ws.buildBloom(bankId);
+        if (ws.autoFreeze) ws.freeze(bankId);
+        return true;
+    }
     fs::path file = contextFileName(cfg, bankId);
     if (!fs::exists(file)) { err = "missing context file: " + file.string(); return false; }
     Bank b;
     if (!loadContextFile(cfg, file, b, err)) return false;
     ws.banks[bankId] = std::move(b);
     ws.filenames[bankId] = file.string();
+    ws.buildBloom(bankId);
+    if (ws.autoFreeze) ws.freeze(bankId);
     return true;
 }
 
+// ----------------------------- Ropes -----------------------------
+// Resolved text as a tree of shared, immutable fragments: spans of a string
+// buffer (a raw value, an include file, a marker), spans of a file left on
+// disk, or whole sub-ropes (a resolved cell). Appending never copies bytes;
+// flatten()/writeTo() do, once, and a FileSink splices file spans kernel-side.
+struct Rope;
+using RopePtr = std::shared_ptr<const Rope>;
+
+// Calls f(string_view) over [off, off+len) of a file, one chunk at a time.
+template<class F> void readFileChunks(const fs::path& p, uint64_t off, uint64_t len, F&& f){
+    std::ifstream in(p, std::ios::binary);
+    in.seekg(std::streamoff(off));
+    std::vector<char> buf(size_t(1) << 20);
+    while (len && in){
+        in.read(buf.data(), std::streamsize(std::min<uint64_t>(len, buf.size())));
+        auto got = size_t(in.gcount());
+        if (!got) break;
+        f(std::string_view(buf.data(), got));
+        len -= got;
+    }
+}
+
+struct Rope {
+    struct Piece {
+        std::shared_ptr<const string> text; size_t off = 0, len = 0;
+        RopePtr sub;                        // set instead of text for a shared sub-rope
+        std::shared_ptr<const fs::path> file; // set instead of text for a span of a file
+    };
+    std::vector<Piece> pieces;
+    size_t size = 0;
+    bool cycleFree = true; // no circular-reference marker anywhere inside
+
+    void append(std::shared_ptr<const string> t, size_t off, size_t len){
+        if (!len) return;
+        pieces.push_back({std::move(t), off, len, nullptr, nullptr}); size += len;
+    }
+    void append(string s){ auto t = std::make_shared<const string>(std::move(s)); size_t n = t->size(); append(std::move(t), 0, n); }
+    void append(RopePtr r){
+        if (!r) return;
+        cycleFree = cycleFree && r->cycleFree;
+        if (!r->size) return;
+        size += r->size;
+        pieces.push_back({nullptr, 0, 0, std::move(r), nullptr});
+    }
+    void appendFile(std::shared_ptr<const fs::path> f, size_t len){
+        if (!len) return;
+        pieces.push_back({nullptr, 0, len, nullptr, std::move(f)}); size += len;
+    }
+    // text(string_view) for in-memory spans, file(path, off, len) for file spans.
+    template<class Text, class File> void visit(Text&& text, File&& file) const {
+        for (auto& p : pieces){
+            if (p.sub) p.sub->visit(text, file);
+            else if (p.file) file(*p.file, uint64_t(p.off), uint64_t(p.len));
+            else text(std::string_view(*p.text).substr(p.off, p.len));
+        }
+    }
+    template<class F> void forEachSpan(F&& f) const {
+        visit(f, [&](const fs::path& path, uint64_t off, uint64_t len){ readFileChunks(path, off, len, f); });
+    }
+    string flatten() const { string s; s.reserve(size); forEachSpan([&](std::string_view v){ s.append(v); }); return s; }
+    void writeTo(std::ostream& os) const { forEachSpan([&](std::string_view v){ os.write(v.data(), std::streamsize(v.size())); }); }
+};
+
+// ----------------------------- Include scanning -----------------------------
+// Whether an include file could contain anything the reference passes would
+// rewrite, decided by one streaming pass (no full read). The check is a
+// superset of the Resolver's patterns: d.d.d anywhere, or an alphanumeric
+// run holding the prefix letter before '.' and another alphanumeric. Results
+// are cached per process by path, size and modification time.
+struct IncludeInfo {
+    bool plain = false;      // no reference could match inside
+    uint64_t size = 0;
+    char first = 0, last = 0;
+};
+
+inline IncludeInfo scanInclude(const Config& cfg, const fs::path& p){
+    static std::mutex mu;
+    static std::map<string, std::tuple<uintmax_t, fs::file_time_type, IncludeInfo>> cache;
+    std::error_code ec;
+    const auto size = fs::file_size(p, ec);
+    if (ec) return {};
+    const auto mtime = fs::last_write_time(p, ec);
+    {
+        std::lock_guard lk(mu);
+        auto it = cache.find(p.string());
+        if (it != cache.end() && std::get<0>(it->second)==size && std::get<1>(it->second)==mtime) return std::get<2>(it->second);
+    }
+    IncludeInfo info; info.size = size; info.plain = true;
+    size_t runLen = 0, prefixAt = 0;   // current alnum run; prefixAt = 1 + index of prefix letter
+    size_t chain = 0;                  // "digits." groups directly before this run
+    bool runDigits = true, pendingTwo = false, first = true;
+    size_t trailDigits = 0;
+    readFileChunks(p, 0, size, [&](std::string_view v){
+        if (!info.plain) return;
+        if (first && !v.empty()){ info.first = v.front(); first = false; }
+        if (!v.empty()) info.last = v.back();
+        for (char c : v){
+            if (std::isalnum((unsigned char)c)){
+                if (pendingTwo || (runLen==0 && chain>=2 && std::isdigit((unsigned char)c))){ info.plain = false; return; }
+                if (runLen==0){ runDigits = true; prefixAt = 0; }
+                if (c==cfg.prefix && !prefixAt) prefixAt = runLen + 1;
+                runDigits = runDigits && std::isdigit((unsigned char)c);
+                trailDigits = std::isdigit((unsigned char)c)? trailDigits+1 : 0;
+                ++runLen;
+                continue;
+            }
+            if (c=='.' && runLen){
+                pendingTwo = prefixAt && prefixAt < runLen;
+                chain = (runDigits && chain)? chain+1 : (trailDigits? 1 : 0);
+            } else { pendingTwo = false; chain = 0; }
+            runLen = 0; trailDigits = 0;
+        }
+    });
+    std::lock_guard lk(mu);
+    cache[p.string()] = {size, mtime, info};
+    return info;
+}
+
+// ----------------------------- Resolve tracing -----------------------------
+inline uint64_t contentHash(std::string_view v){
+    uint64_t h = 1469598103934665603ull; // FNV-1a
+    for (unsigned char c : v){ h ^= c; h *= 1099511628211ull; }
+    return h? h : 1; // 0 marks a missing cell
+}
+
+struct CacheDep { int64_t bank, reg, addr; uint64_t hash; }; // hash 0: the cell was missing
+
+// What one resolution read: every cell lookup, every include buffer, and
+// whether any include was spliced from disk instead of read.
+struct ResolveTrace {
+    std::vector<CacheDep> cells;
+    std::vector<string> files;
+    bool spliced = false;
+    void append(const ResolveTrace& t){
+        cells.insert(cells.end(), t.cells.begin(), t.cells.end());
+        files.insert(files.end(), t.files.begin(), t.files.end());
+        spliced = spliced || t.spliced;
+    }
+};
+
 // ----------------------------- Resolver (both styles active) -----------------------------
 struct Resolver {
     const Config& cfg;
     Workspace& ws;
+    bool autoload = true; // false: never touch ws, so resolvers on several threads may share it
+    const Overlay* overlay = nullptr; // read through this layer when set
+    mutable ResolveTrace* trace = nullptr; // records what resolution reads when set
     Resolver(const Config& c, Workspace& w): cfg(c), ws(w) {}
 
     bool getValue(long long bank, long long reg, long long addr, string& out) const {
         string err;
-        (void)ensureBankLoadedInWorkspace(cfg, const_cast<Workspace&>(ws), bank, err);
-        auto itB = ws.banks.find(bank);
-        if (itB==ws.banks.end()) return false;
-        const auto& b = itB->second;
-        auto itR = b.regs.find(reg);
-        if (itR==b.regs.end()) return false;
-        auto itA = itR->second.find(addr);
-        if (itA==itR->second.end()) return false;
-        out = itA->second;
-        return true;
+        // Frozen banks and banks in an attached image are read in place, never copied.
+        if (autoload && !ws.frozen.count(bank) && !(ws.image && ws.image->hasBank(bank))){
+            auto& w = const_cast<Workspace&>(ws);
+            (void)ensureBankLoadedInWorkspace(cfg, w, bank, err);
+            if (!w.bloom(bank) && !w.frozen.count(bank)) w.buildBloom(bank); // after bulk edits
+        }
+        const bool found = lookupCell(ws, overlay, bank, reg, addr, out);
+        if (trace) trace->cells.push_back({bank, reg, addr, found? contentHash(out) : 0});
+        return found;
     }
     bool getValueTwoPart(long long bank, long long addr, string& out) const {
-        string err;
-        (void)ensureBankLoadedInWorkspace(cfg, const_cast<Workspace&>(ws), bank, err);
         return getValue(bank, 1, addr, out);
     }
-    string includeFile(const string& name) const {
+    string includeFile(const string& name) const { return *includeBuffer(name); }
+
+    // Each file is read once per Resolver and shared by every fragment that
+    // includes it.
+    std::shared_ptr<const string> includeBuffer(const string& name) const {
+        if (trace) trace->files.push_back(name);
+        auto it = includes.find(name);
+        if (it != includes.end()) return it->second;
         fs::path p = fs::path("files") / name;
-        if (!fs::exists(p)) return string("[Missing file: ")+name+"]";
-        std::ifstream in(p, std::ios::binary);
-        if (!in) return string("[Cannot open file: ")+name+"]";
-        return string( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+        string text;
+        if (!fs::exists(p)) text = string("[Missing file: ")+name+"]";
+        else {
+            std::ifstream in(p, std::ios::binary);
+            if (!in) text = string("[Cannot open file: ")+name+"]";
+            else text.assign( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+        }
+        return includes[name] = std::make_shared<const string>(std::move(text));
     }
 
     string resolve(const string& input, long long currentBank, std::unordered_set<string>& visited) const {
-        string s = input;
-        {   // @file(...)
-            static std::regex fileRe(R"(@file\(([^)]+)\))");
-            std::smatch m; string out; out.reserve(s.size());
-            string::const_iterator searchStart( s.cbegin() ); size_t last = 0;
-            while (std::regex_search(searchStart, s.cend(), m, fileRe)) {
-                size_t pos = m.position(0) + (searchStart - s.cbegin());
-                size_t len = m.length(0);
-                out.append(s, last, pos - last);
-                string fname = trim(m[1].str());
-                out += includeFile(fname);
-                searchStart = s.cbegin() + pos + len;
-                last = pos + len;
-            }
-            out.append(s, last, string::npos);
-            s.swap(out);
-        }
-        {   // three-part numeric: b.r.a
-            static std::regex tri(R"((\d+)\.(\d+)\.(\d+))");
-            std::smatch m; string out; out.reserve(s.size());
-            string::const_iterator searchStart( s.cbegin() ); size_t last = 0;
-            while (std::regex_search(searchStart, s.cend(), m, tri)) {
-                size_t pos = m.position(0) + (searchStart - s.cbegin());
-                size_t len = m.length(0);
-                out.append(s, last, pos - last);
-                long long b = std::stoll(m[1].str());
-                long long r = std::stoll(m[2].str());
-                long long a = std::stoll(m[3].str());
-                string key = std::to_string(b)+"."+std::to_string(r)+"."+std::to_string(a);
-                if (visited.count(key)) out += "[Circular Ref: " + m[0].str() + "]";
-                else {
-                    string v;
-                    if (!getValue(b, r, a, v)) out += "[Missing " + m[0].str() + "]";
-                    else { auto v2=visited; v2.insert(key); out += resolve(v, b, v2); }
+        AllocScope scope(AllocOp::Resolve);
+        return resolveRope(input, currentBank, visited)->flatten();
+    }
+
+    // Same passes as always (@file, then b.r.a, then x<bank>.<addr>), applied
+    // per fragment: include buffers are shared, not copied. The x<bank>.<addr>
+    // pass still sees what b.r.a substituted, joined with its neighbours, so
+    // text around on-disk spans is flattened once b.r.a has replaced anything.
+    RopePtr resolveRope(const string& input, long long currentBank, std::unordered_set<string>& visited) const {
+        (void)currentBank;
+        static const std::regex fileRe(R"(@file\(([^)]+)\))");
+        static const std::regex tri(R"((\d+)\.(\d+)\.(\d+))");
+        static const std::regex two(R"(([A-Za-z])([0-9A-Za-z]+)\.([0-9A-Za-z]+))");
+        auto src = std::make_shared<const string>(input);
+
+        // Runs re over each text piece of `in`, keeping unmatched text as spans
+        // and replacing each match with onMatch(m); sub-ropes pass through.
+        auto pass = [](const Rope& in, const std::regex& re, auto&& onMatch){
+            auto out = std::make_shared<Rope>();
+            out->cycleFree = in.cycleFree;
+            for (auto& p : in.pieces){
+                if (p.sub){ out->append(p.sub); continue; }
+                if (p.file){ out->appendFile(p.file, p.len); continue; }
+                const char* first = p.text->data() + p.off, *last = first + p.len, *at = first;
+                std::cmatch m;
+                while (std::regex_search(at, last, m, re)){
+                    const size_t pos = size_t(m[0].first - first), len = size_t(m.length(0));
+                    out->append(p.text, p.off + size_t(at - first), pos - size_t(at - first));
+                    onMatch(m, *out, at == first);
+                    at = first + pos + len;
                 }
-                searchStart = s.cbegin() + pos + len; last = pos + len;
+                out->append(p.text, p.off + size_t(at - first), size_t(last - at));
             }
-            out.append(s, last, string::npos);
-            s.swap(out);
-        }
-        {   // two-part prefixed: x<bank>.<addr>
-            static std::regex two(R"(([A-Za-z])([0-9A-Za-z]+)\.([0-9A-Za-z]+))");
-            std::smatch m; string out; out.reserve(s.size());
-            string::const_iterator searchStart( s.cbegin() ); size_t last = 0;
-            while (std::regex_search(searchStart, s.cend(), m, two)) {
-                size_t pos = m.position(0) + (searchStart - s.cbegin());
-                size_t len = m.length(0);
-                out.append(s, last, pos - last);
-                char pf = m[1].str()[0];
-                if (pf != cfg.prefix) out += m[0].str();
-                else {
-                    long long b=0, a=0;
-                    if (!parseIntBase(m[2].str(), cfg.base, b) || !parseIntBase(m[3].str(), cfg.base, a)) {
-                        out += "[BadRef " + m[0].str() + "]";
-                    } else {
-                        string key = string(1, pf) + m[2].str() + "." + m[3].str();
-                        if (visited.count(key)) out += "[Circular Ref: " + m[0].str() + "]";
-                        else {
-                            string v;
-                            if (!getValueTwoPart(b, a, v)) out += "[Missing " + m[0].str() + "]";
-                            else { auto v2=visited; v2.insert(key); out += resolve(v, b, v2); }
-                        }
-                    }
+            return out;
+        };
+
+        Rope base; base.append(src, 0, src->size());
+        bool joined = false; // an included buffer's edge could form a reference with its neighbour
+        auto withFiles = pass(base, fileRe, [&](const std::cmatch& m, Rope& out, bool atStart){
+            const string name = trim(m[1].str());
+            // A plain file stays on disk unless a neighbouring character could
+            // join a reference across its edges (e.g. "1.2.@file(n)" with n = "3").
+            auto joins = [](char c){ return std::isalnum((unsigned char)c) || c=='.' || c=='@'; };
+            const fs::path path = fs::path("files") / name;
+            IncludeInfo info = scanInclude(cfg, path);
+            const bool before = m.prefix().length() ? joins(m[0].first[-1]) : !atStart;
+            const bool after  = m.suffix().length() && joins(*m[0].second);
+            if (info.plain && !(before && joins(info.first)) && !(after && joins(info.last))){
+                out.appendFile(std::make_shared<const fs::path>(path), size_t(info.size));
+                if (trace) trace->spliced = true;
+                return;
+            }
+            auto buf = includeBuffer(name);
+            if (!buf->empty()) joined = joined || (before && joins(buf->front())) || (after && joins(buf->back()));
+            out.append(buf, 0, buf->size());
+        });
+        if (joined){ // later passes must see one flat text, as before ropes
+            auto flat = std::make_shared<Rope>();
+            flat->append(withFiles->flatten());
+            withFiles = flat;
+        }
+        bool replaced = false;
+        auto withTri = pass(*withFiles, tri, [&](const std::cmatch& m, Rope& out, bool){
+            long long b = std::stoll(m[1].str()), r = std::stoll(m[2].str()), a = std::stoll(m[3].str());
+            string key = std::to_string(b)+"."+std::to_string(r)+"."+std::to_string(a);
+            out.append(refRope(b, r, a, key, m[0].str(), visited));
+            replaced = true;
+        });
+        if (replaced){ // plain file spans, also those inside sub-ropes, stay on disk
+            std::vector<const Rope::Piece*> leaves;
+            auto collect = [&](auto& self, const Rope& r) -> void {
+                for (auto& p : r.pieces){ if (p.sub) self(self, *p.sub); else leaves.push_back(&p); }
+            };
+            collect(collect, *withTri);
+            // A substituted span now has new neighbours; one that could join them is read in.
+            auto joins = [](char c){ return std::isalnum((unsigned char)c) || c=='.' || c=='@'; };
+            auto edge = [&](const Rope::Piece& p, bool front){
+                if (!p.file) return (*p.text)[front? p.off : p.off + p.len - 1];
+                IncludeInfo info = scanInclude(cfg, *p.file);
+                return front? info.first : info.last;
+            };
+            auto flat = std::make_shared<Rope>();
+            flat->cycleFree = withTri->cycleFree;
+            string run;
+            for (size_t i = 0; i < leaves.size(); ++i){
+                const Rope::Piece& p = *leaves[i];
+                if (!p.file){ run.append(*p.text, p.off, p.len); continue; }
+                const bool before = i > 0 && joins(edge(*leaves[i-1], false)) && joins(edge(p, true));
+                const bool after = i+1 < leaves.size() && joins(edge(*leaves[i+1], true)) && joins(edge(p, false));
+                if (before || after){
+                    readFileChunks(*p.file, p.off, p.len, [&](std::string_view v){ run.append(v); });
+                    continue;
                 }
-                searchStart = s.cbegin() + pos + len; last = pos + len;
+                flat->append(std::move(run)); run.clear();
+                flat->appendFile(p.file, p.len);
+            }
+            flat->append(std::move(run));
+            withTri = flat;
+        }
+        return pass(*withTri, two, [&](const std::cmatch& m, Rope& out, bool){
+            char pf = m[1].str()[0];
+            if (pf != cfg.prefix){ out.append(m[0].str()); return; }
+            long long b=0, a=0;
+            if (!parseIntBase(m[2].str(), cfg.base, b) || !parseIntBase(m[3].str(), cfg.base, a)){
+                out.append("[BadRef " + m[0].str() + "]"); return;
             }
-            out.append(s, last, string::npos);
-            s.swap(out);
+            string key = string(1, pf) + m[2].str() + "." + m[3].str();
+            out.append(refRope(b, 1, a, key, m[0].str(), visited));
+        });
+    }
+
+private:
+    mutable std::unordered_map<string, std::shared_ptr<const string>> includes;
+    // Resolved cells that met no cycle, so they do not depend on `visited`.
+    mutable std::map<std::tuple<long long,long long,long long>, RopePtr> memo;
+    mutable std::map<std::tuple<long long,long long,long long>, ResolveTrace> memoTrace; // while tracing
+
+    RopePtr refRope(long long b, long long r, long long a, const string& key, const string& token,
+                    const std::unordered_set<string>& visited) const {
+        auto marker = [](string text, bool cycle){
+            auto m = std::make_shared<Rope>(); m->append(std::move(text));
+            m->cycleFree = !cycle;
+            return m;
+        };
+        if (visited.count(key)) return marker("[Circular Ref: " + token + "]", true);
+        if (auto it = memo.find({b, r, a}); it != memo.end()){
+            if (!trace) return it->second;
+            if (auto t = memoTrace.find({b, r, a}); t != memoTrace.end()){ trace->append(t->second); return it->second; }
+        }
+        // A memoised rope is reused without re-reading, so keep what it read.
+        ResolveTrace* outer = trace; ResolveTrace inner;
+        struct Restore { ResolveTrace*& t; ResolveTrace* v; ~Restore(){ t = v; } } restore{trace, outer};
+        if (outer) trace = &inner;
+        string v;
+        if (!getValue(b, r, a, v)){
+            if (outer) outer->append(inner);
+            return marker("[Missing " + token + "]", false);
+        }
+        auto v2 = visited; v2.insert(key);
+        auto sub = resolveRope(v, b, v2);
+        if (outer) outer->append(inner);
+        if (sub->cycleFree){
+            memo[{b, r, a}] = sub;
+            if (outer) memoTrace[{b, r, a}] = std::move(inner);
         }
-        return s;
+        return sub;
     }
 };
 
+// ----------------------------- Reference scanning -----------------------------
+// References as written in a raw value, using the Resolver's patterns: text
+// inside @file(...) is skipped, and two-part matches overlapping a three-part
+// one are ignored. Two-part refs imply register 1.
+struct RefSpan {
+    size_t pos = 0, len = 0;
+    bool twoPart = false;
+    long long bank = 0, reg = 0, addr = 0;
+};
+
+inline std::vector<RefSpan> scanRefs(const string& s, const Config& cfg){
+    static const std::regex fileRe(R"(@file\(([^)]+)\))");
+    static const std::regex tri(R"((\d+)\.(\d+)\.(\d+))");
+    static const std::regex two(R"(([A-Za-z])([0-9A-Za-z]+)\.([0-9A-Za-z]+))");
+    std::vector<std::pair<size_t,size_t>> masked;
+    auto isMasked = [&](size_t pos, size_t len){
+        for (auto& [p, l] : masked) if (pos < p + l && p < pos + len) return true;
+        return false;
+    };
+    for (auto it = std::sregex_iterator(s.begin(), s.end(), fileRe); it != std::sregex_iterator(); ++it)
+        masked.emplace_back(size_t(it->position(0)), size_t(it->length(0)));
+    std::vector<RefSpan> out;
+    for (auto it = std::sregex_iterator(s.begin(), s.end(), tri); it != std::sregex_iterator(); ++it){
+        size_t pos = size_t(it->position(0)), len = size_t(it->length(0));
+        if (isMasked(pos, len)) continue;
+        try {
+            out.push_back({pos, len, false, std::stoll((*it)[1].str()), std::stoll((*it)[2].str()), std::stoll((*it)[3].str())});
+        } catch (...) { continue; }
+        masked.emplace_back(pos, len);
+    }
+    for (auto it = std::sregex_iterator(s.begin(), s.end(), two); it != std::sregex_iterator(); ++it){
+        size_t pos = size_t(it->position(0)), len = size_t(it->length(0));
+        if ((*it)[1].str()[0] != cfg.prefix || isMasked(pos, len)) continue;
+        long long b=0, a=0;
+        if (!parseIntBase((*it)[2].str(), cfg.base, b) || !parseIntBase((*it)[3].str(), cfg.base, a)) continue;
+        out.push_back({pos, len, true, b, 1, a});
+    }
+    std::sort(out.begin(), out.end(), [](const RefSpan& x, const RefSpan& y){ return x.pos < y.pos; });
+    return out;
+}
+
 // ----------------------------- Config file helpers -----------------------------
 inline void ensurePaths(const Paths& P){ P.ensure(); }
 inline Config loadConfig(const Paths& P){
@@ -477,8 +1457,10 @@ inline bool openCtx(const Config& cfg,
         return false;
     }
 
+    AllocScope scope(AllocOp::Load);
     auto path = contextFileName(cfg, id);
     Bank b;
+    ws.touch(id); // (re)opening replaces the bank: anything keyed on its revision is stale
 
     if (std::filesystem::exists(path)) {
         // OPEN FOR READING ONLY — opening must NOT fail if file is read-only
@@ -489,39 +1471,408 @@ inline bool openCtx(const Config& cfg,
         if (!pr.ok) { status = "Parse failed: " + pr.err; return false; }
         if (b.title.empty()) b.title = stem;
         ws.banks[id] = std::move(b);
+        ws.buildBloom(id);
         status = "Opened " + path.string();
         return true;
     }
 
+    // No file: take a private copy from an attached image if it has the bank
+    if (ws.image && ws.image->bank(id, b)) {
+        ws.banks[id] = std::move(b);
+        ws.buildBloom(id);
+        status = "Opened from image (writes go to " + path.string() + ")";
+        return true;
+    }
+
     // New (empty) bank if file doesn't exist
     b.title = stem;
     ws.banks[id] = std::move(b);
+    ws.buildBloom(id);
     status = "Created new context: " + path.string();
     return true;
 }
 
 
-inline string resolveBankToText(const Config& cfg, Workspace& ws, long long bankId){
+// ----------------------------- Resolved-value cache -----------------------------
+// files/.cache/<ctx>.rcache keeps each cell's resolved value from earlier runs
+// with everything that went into it: the hash of the cell's own text, of every
+// cell the resolver read (0 = it was missing) and the size and mtime of every
+// include read into memory. An entry is used only while all of those still
+// match. Each cell read is listed once per file and entries index into that
+// list. Cells with an include spliced from disk are not cached. The file is
+// mapped on first lookup and rewritten (beside it, then renamed) only when
+// entries were added or dropped.
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t base;
+    char prefix, pad[7];
+    uint64_t entries, entryOff, deps, depOff, depRefs, depRefOff, files, fileOff, strOff, strSize;
+};
+struct CacheEntry { int64_t reg, addr; uint64_t selfHash, firstDep, depCount, firstFile, fileCount, textOff, textLen; }; // deps via depRefs
+struct CacheFileDep { uint64_t nameOff, nameLen, size; int64_t mtime; }; // size ~0: file was missing
+inline constexpr char kCacheMagic[8] = {'S','C','R','C','A','C','H','\0'};
+inline constexpr uint32_t kCacheVersion = 1;
+
+class ResolveCache {
+public:
+    ResolveCache(const Config& c, const Resolver& r, fs::path file): cfg(c), R(r), path(std::move(file)) {}
+    ResolveCache(const ResolveCache&) = delete;
+    ResolveCache& operator=(const ResolveCache&) = delete;
+
+    size_t hits = 0, misses = 0;
+
+    // The cached value of (reg, addr) whose raw text is `raw`, if still valid.
+    // Call in bank order, with R not tracing.
+    std::optional<std::string_view> lookup(long long reg, long long addr, std::string_view raw){
+        load();
+        const CacheEntry* e = find(reg, addr);
+        if (!e || e->selfHash != contentHash(raw) || !valid(*e)){ ++misses; return std::nullopt; }
+        ++hits;
+        order.push_back({e, 0});
+        return str(e->textOff, e->textLen);
+    }
+
+    // Records a fresh resolution of (reg, addr); call in bank order.
+    void store(long long reg, long long addr, std::string_view raw, string resolved, ResolveTrace t){
+        auto byCell = [](const CacheDep& x, const CacheDep& y){ return std::tie(x.bank, x.reg, x.addr) < std::tie(y.bank, y.reg, y.addr); };
+        auto sameCell = [](const CacheDep& x, const CacheDep& y){ return x.bank==y.bank && x.reg==y.reg && x.addr==y.addr; };
+        std::sort(t.cells.begin(), t.cells.end(), byCell);
+        t.cells.erase(std::unique(t.cells.begin(), t.cells.end(), sameCell), t.cells.end());
+        std::sort(t.files.begin(), t.files.end());
+        t.files.erase(std::unique(t.files.begin(), t.files.end()), t.files.end());
+        fresh.push_back({reg, addr, contentHash(raw), std::move(resolved), std::move(t)});
+        order.push_back({nullptr, fresh.size()});
+    }
+
+    // Writes the file when it would differ from the one on disk.
+    bool flush(string& err){
+        load();
+        const size_t oldCount = hdr? size_t(hdr->entries) : 0;
+        if (fresh.empty() && order.size() == oldCount) return true;
+        std::vector<CacheEntry> entries;
+        std::vector<CacheDep> deps;
+        std::vector<uint32_t> depRefs;
+        std::map<std::tuple<int64_t,int64_t,int64_t>, uint32_t> depId;
+        auto ref = [&](const CacheDep& d){
+            auto [it, isNew] = depId.try_emplace({d.bank, d.reg, d.addr}, uint32_t(deps.size()));
+            if (isNew) deps.push_back(d);
+            depRefs.push_back(it->second);
+        };
+        std::vector<CacheFileDep> files;
+        string blob;
+        for (auto& [old, idx] : order){
+            CacheEntry e{};
+            if (old){
+                e = *old;
+                e.firstDep = depRefs.size(); e.firstFile = files.size();
+                for (uint64_t i = 0; i < old->depCount; ++i) ref(this->deps[this->depRefs[old->firstDep + i]]);
+                for (uint64_t i = 0; i < old->fileCount; ++i){
+                    CacheFileDep f = this->files[old->firstFile + i];
+                    std::string_view name = str(f.nameOff, f.nameLen);
+                    f.nameOff = blob.size(); blob += name;
+                    files.push_back(f);
+                }
+                std::string_view text = str(old->textOff, old->textLen);
+                e.textOff = blob.size(); blob += text;
+            } else {
+                Fresh& f = fresh[idx - 1];
+                e = {f.reg, f.addr, f.selfHash, depRefs.size(), f.trace.cells.size(), files.size(), f.trace.files.size(), 0, 0};
+                for (auto& d : f.trace.cells) ref(d);
+                for (auto& name : f.trace.files){
+                    auto [size, mtime] = stamp(name);
+                    files.push_back({blob.size(), name.size(), size, mtime});
+                    blob += name;
+                }
+                e.textOff = blob.size(); e.textLen = f.text.size(); blob += f.text;
+            }
+            entries.push_back(e);
+        }
+        CacheHeader h{};
+        std::memcpy(h.magic, kCacheMagic, sizeof kCacheMagic);
+        h.version = kCacheVersion; h.base = cfg.base; h.prefix = cfg.prefix;
+        h.entries = entries.size(); h.deps = deps.size(); h.depRefs = depRefs.size(); h.files = files.size();
+        h.entryOff  = sizeof h;
+        h.depOff    = h.entryOff + entries.size() * sizeof(CacheEntry);
+        h.depRefOff = h.depOff + deps.size() * sizeof(CacheDep);
+        h.fileOff   = h.depRefOff + (depRefs.size() * sizeof(uint32_t) + 7) / 8 * 8;
+        h.strOff   = h.fileOff + files.size() * sizeof(CacheFileDep);
+        h.strSize  = blob.size();
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+        const fs::path tmp = uniqueTempPath(path);
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out){ err = "cannot write " + tmp.string(); return false; }
+            out.write(reinterpret_cast<const char*>(&h), sizeof h);
+            out.write(reinterpret_cast<const char*>(entries.data()), std::streamsize(entries.size() * sizeof(CacheEntry)));
+            out.write(reinterpret_cast<const char*>(deps.data()), std::streamsize(deps.size() * sizeof(CacheDep)));
+            out.write(reinterpret_cast<const char*>(depRefs.data()), std::streamsize(depRefs.size() * sizeof(uint32_t)));
+            if (depRefs.size() % 2) out.write("\0\0\0\0", 4); // keep the next table 8-aligned
+            out.write(reinterpret_cast<const char*>(files.data()), std::streamsize(files.size() * sizeof(CacheFileDep)));
+            out.write(blob.data(), std::streamsize(blob.size()));
+            if (!out){ out.close(); fs::remove(tmp, ec); err = "write failed: " + tmp.string(); return false; }
+        }
+        fs::rename(tmp, path, ec);
+        if (ec){ fs::remove(tmp, ec); err = ec.message(); return false; }
+        return true;
+    }
+
+private:
+    struct Fresh { int64_t reg, addr; uint64_t selfHash; string text; ResolveTrace trace; };
+    const Config& cfg;
+    const Resolver& R;
+    fs::path path;
+    bool loaded = false;
+    MappedFile file;
+    const CacheHeader* hdr = nullptr;
+    const CacheEntry* entries = nullptr;
+    const CacheDep* deps = nullptr;
+    const uint32_t* depRefs = nullptr;
+    const CacheFileDep* files = nullptr;
+    const char* strings = nullptr;
+    std::vector<std::pair<const CacheEntry*, size_t>> order; // kept entry, or 1-based index into fresh
+    std::vector<Fresh> fresh;
+    std::vector<char> depState; // per deps[] entry: 0 unchecked, 1 unchanged, 2 changed
+    std::map<string, bool> filesOk;
+
+    // Opens the file on first use; a missing, foreign or damaged file is ignored.
+    void load(){
+        if (loaded) return;
+        loaded = true;
+        string err;
+        std::error_code ec;
+        if (!fs::exists(path, ec) || !file.open(path, err)) return;
+        const char* base = file.data(); const size_t size = file.size();
+        auto fits = [&](uint64_t off, uint64_t n, uint64_t each){ return off <= size && n <= (size - off) / each; };
+        if (size < sizeof(CacheHeader) || std::memcmp(base, kCacheMagic, sizeof kCacheMagic) != 0) return;
+        auto h = reinterpret_cast<const CacheHeader*>(base);
+        if (h->version != kCacheVersion || h->base != cfg.base || h->prefix != cfg.prefix) return;
+        if (!fits(h->entryOff, h->entries, sizeof(CacheEntry)) || !fits(h->depOff, h->deps, sizeof(CacheDep)) ||
+            !fits(h->depRefOff, h->depRefs, sizeof(uint32_t)) || !fits(h->fileOff, h->files, sizeof(CacheFileDep)) ||
+            !fits(h->strOff, h->strSize, 1)) return;
+        auto e = reinterpret_cast<const CacheEntry*>(base + h->entryOff);
+        for (uint64_t i = 0; i < h->entries; ++i)
+            if (e[i].firstDep > h->depRefs || e[i].depCount > h->depRefs - e[i].firstDep ||
+                e[i].firstFile > h->files || e[i].fileCount > h->files - e[i].firstFile) return;
+        auto r = reinterpret_cast<const uint32_t*>(base + h->depRefOff);
+        for (uint64_t i = 0; i < h->depRefs; ++i) if (r[i] >= h->deps) return;
+        hdr = h; entries = e; depRefs = r;
+        depState.assign(size_t(h->deps), 0);
+        deps = reinterpret_cast<const CacheDep*>(base + h->depOff);
+        files = reinterpret_cast<const CacheFileDep*>(base + h->fileOff);
+        strings = base + h->strOff;
+    }
+    const CacheEntry* find(long long reg, long long addr) const {
+        if (!hdr) return nullptr;
+        const CacheEntry* last = entries + hdr->entries;
+        auto it = std::lower_bound(entries, last, std::pair(reg, addr), [](const CacheEntry& c, const std::pair<long long,long long>& k){
+            return std::pair<long long,long long>(c.reg, c.addr) < k;
+        });
+        return (it != last && it->reg == reg && it->addr == addr)? it : nullptr;
+    }
+    std::string_view str(uint64_t off, uint64_t len) const {
+        if (off > hdr->strSize || len > hdr->strSize - off) return {};
+        return std::string_view(strings + off, size_t(len));
+    }
+    static std::pair<uint64_t, int64_t> stamp(const string& name){
+        std::error_code ec;
+        const fs::path p = fs::path("files") / name;
+        const auto size = fs::file_size(p, ec);
+        if (ec) return {~0ull, 0};
+        const auto mtime = fs::last_write_time(p, ec);
+        return {uint64_t(size), ec? 0 : int64_t(mtime.time_since_epoch().count())};
+    }
+    bool valid(const CacheEntry& e){
+        for (uint64_t i = 0; i < e.depCount; ++i){
+            const uint32_t k = depRefs[e.firstDep + i];
+            if (!depState[k]){
+                const CacheDep& d = deps[k];
+                string v;
+                depState[k] = (R.getValue(d.bank, d.reg, d.addr, v)? contentHash(v) : 0) == d.hash? 1 : 2;
+            }
+            if (depState[k] != 1) return false;
+        }
+        for (uint64_t i = 0; i < e.fileCount; ++i){
+            const CacheFileDep& f = files[e.firstFile + i];
+            const string name(str(f.nameOff, f.nameLen));
+            auto [it, isNew] = filesOk.try_emplace(name, false);
+            if (isNew){
+                auto [size, mtime] = stamp(name);
+                it->second = size == f.size && mtime == f.mtime;
+            }
+            if (!it->second) return false;
+        }
+        return true;
+    }
+};
+
+// Writes the resolved bank text as it goes: text(string_view) for formatting
+// and in-memory fragments, file(path, off, len) for include spans on disk.
+template<class Text, class File>
+void emitResolvedBank(const Config& cfg, Workspace& ws, long long bankId, const Overlay* ov, Text&& text, File&& file){
+    AllocScope scope(AllocOp::Resolve);
     Resolver R(cfg, ws);
-    auto& b = ws.banks[bankId];
-    std::ostringstream os;
-    string bankStr = string(1,cfg.prefix) + toBaseN(b.id, cfg.base, cfg.widthBank);
-    os << bankStr << "\t(" << b.title << "){\n";
-    for (auto& [rid, addrs] : b.regs){
-        if (b.regs.size()>1) os << toBaseN(rid, cfg.base, cfg.widthReg) << "\n";
-        for (auto& [aid, val] : addrs){
-            std::unordered_set<string> visited;
-            string out = R.resolve(val, b.id, visited);
-            os << "\t" << toBaseN(aid, cfg.base, cfg.widthAddr) << "\t" << out << "\n";
+    R.overlay = ov;
+    Bank layered;
+    if (ov) layered = overlaidBank(ws, *ov, bankId);
+    // A bank only in the attached image is walked there, never copied out.
+    const Bank* b = ov? &layered : nullptr;
+    if (auto it = ws.banks.find(bankId); !b && it != ws.banks.end()) b = &it->second;
+    const WorkspaceImage* img = !b && ws.image && ws.image->hasBank(bankId)? ws.image.get() : nullptr;
+    if (!b && !img) b = &ws.banks[bankId];
+    const long long id = b? b->id : bankId;
+    string bankStr = string(1,cfg.prefix) + toBaseN(id, cfg.base, cfg.widthBank);
+    text(bankStr + "\t(" + (b? b->title : img->title(bankId)) + "){\n");
+    std::optional<ResolveCache> cache; // overlays are what-ifs: never cached
+    if (!ov && !ws.cacheDir.empty())
+        cache.emplace(cfg, R, ws.cacheDir / (contextFileName(cfg, bankId).stem().string() + ".rcache"));
+    auto cell = [&](long long rid, long long aid, const string& val){
+        text("\t" + toBaseN(aid, cfg.base, cfg.widthAddr) + "\t");
+        if (cache) if (auto hit = cache->lookup(rid, aid, val)){ text(*hit); text("\n"); return; }
+        std::unordered_set<string> visited;
+        ResolveTrace t;
+        if (cache) R.trace = &t;
+        auto rope = R.resolveRope(val, id, visited);
+        R.trace = nullptr;
+        rope->visit(text, file);
+        if (cache && !t.spliced) cache->store(rid, aid, val, rope->flatten(), std::move(t));
+        text("\n");
+    };
+    if (auto f = ws.frozen.find(bankId); !ov && f != ws.frozen.end()){ // walk the compact cells
+        const bool many = f->second->registers() > 1;
+        f->second->forEach(
+            [&](long long rid){ if (many) text(toBaseN(rid, cfg.base, cfg.widthReg) + "\n"); },
+            [&](long long rid, long long aid, std::string_view val){ cell(rid, aid, string(val)); });
+    } else if (img){
+        const bool many = img->registers(bankId) > 1;
+        img->forEach(bankId,
+            [&](long long rid){ if (many) text(toBaseN(rid, cfg.base, cfg.widthReg) + "\n"); },
+            [&](long long rid, long long aid, std::string_view val){ cell(rid, aid, string(val)); });
+    } else {
+        for (auto& [rid, addrs] : b->regs){
+            if (b->regs.size()>1) text(toBaseN(rid, cfg.base, cfg.widthReg) + "\n");
+            for (auto& [aid, val] : addrs) cell(rid, aid, val);
         }
     }
-    os << "}\n";
-    return os.str();
+    text("}\n");
+    if (cache){
+        string err; // a cache that cannot be written only costs the next run time
+        (void)cache->flush(err);
+        ws.cacheHits += cache->hits; ws.cacheMisses += cache->misses;
+    }
+}
+
+inline string resolveBankToText(const Config& cfg, Workspace& ws, long long bankId, const Overlay* ov = nullptr){
+    string out;
+    auto text = [&](std::string_view v){ out.append(v); };
+    emitResolvedBank(cfg, ws, bankId, ov, text,
+                     [&](const fs::path& p, uint64_t off, uint64_t len){ readFileChunks(p, off, len, text); });
+    return out;
+}
+
+// Output file that splices include spans from their source files without
+// passing them through user space (copy_file_range, then sendfile, then a
+// plain read/write loop, whichever the platform and filesystems allow).
+class FileSink {
+public:
+    explicit FileSink(const fs::path& path){
+#if defined(_WIN32)
+        out.open(path, std::ios::binary | std::ios::trunc);
+        failed = !out;
+#else
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        failed = fd < 0;
+#endif
+        if (failed) err = "cannot write " + path.string();
+    }
+    ~FileSink(){ string e; close(e); }
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    void write(std::string_view v){
+        buf.append(v);
+        if (buf.size() >= (size_t(1) << 16)) flush();
+    }
+    void splice(const fs::path& src, uint64_t off, uint64_t len){
+        flush();
+        if (failed) return;
+#if !defined(_WIN32)
+        int in = ::open(src.c_str(), O_RDONLY);
+        if (in >= 0){
+#if defined(__linux__)
+            off_t pos = off_t(off);
+            while (len){
+                ssize_t n = copy_file_range(in, &pos, fd, nullptr, size_t(std::min<uint64_t>(len, 1u << 30)), 0);
+                if (n <= 0) break;
+                len -= uint64_t(n);
+            }
+            while (len){
+                ssize_t n = sendfile(fd, in, &pos, size_t(std::min<uint64_t>(len, 1u << 30)));
+                if (n <= 0) break;
+                len -= uint64_t(n);
+            }
+            off = uint64_t(pos);
+#endif
+            ::close(in);
+        }
+#endif
+        if (len) readFileChunks(src, off, len, [&](std::string_view v){ raw(v); });
+    }
+    bool close(string& e){
+        flush();
+#if defined(_WIN32)
+        if (out.is_open()){ out.close(); failed = failed || !out; }
+#else
+        if (fd >= 0){ if (::close(fd) != 0) failed = true; fd = -1; }
+#endif
+        if (failed && err.empty()) err = "write failed";
+        e = err;
+        return !failed;
+    }
+
+private:
+#if defined(_WIN32)
+    std::ofstream out;
+#else
+    int fd = -1;
+#endif
+    string buf, err;
+    bool failed = false;
+
+    void flush(){ raw(buf); buf.clear(); }
+    void raw(std::string_view v){
+        if (failed || v.empty()) return;
+#if defined(_WIN32)
+        out.write(v.data(), std::streamsize(v.size()));
+        failed = !out;
+#else
+        while (!v.empty()){
+            ssize_t n = ::write(fd, v.data(), v.size());
+            if (n <= 0){ failed = true; return; }
+            v.remove_prefix(size_t(n));
+        }
+#endif
+    }
+};
+
+// Streams the resolved bank into path; plain include files are spliced.
+inline bool resolveBankToFile(const Config& cfg, Workspace& ws, long long bankId, const fs::path& path,
+                              string& err, const Overlay* ov = nullptr){
+    FileSink sink(path);
+    emitResolvedBank(cfg, ws, bankId, ov,
+                     [&](std::string_view v){ sink.write(v); },
+                     [&](const fs::path& p, uint64_t off, uint64_t len){ sink.splice(p, off, len); });
+    return sink.close(err);
 }
 
-inline string exportBankToJSON(const Config& cfg, Workspace& ws, long long bankId){
+inline string exportBankToJSON(const Config& cfg, Workspace& ws, long long bankId, const Overlay* ov = nullptr){
+    AllocScope scope(AllocOp::Export);
     Resolver R(cfg, ws);
-    auto& b = ws.banks[bankId];
+    R.overlay = ov;
+    Bank layered;
+    if (ov) layered = overlaidBank(ws, *ov, bankId);
+    auto& b = ov? layered : ws.banks[bankId];
     std::ostringstream os;
     os << "{\n";
     os << "  \"bank\": \""<< cfg.prefix<<toBaseN(b.id,cfg.base,cfg.widthBank) <<"\",\n";
@@ -568,4 +1919,500 @@ inline void preloadAll(const Config& cfg, Workspace& ws){
     }
 }
 
+// ----------------------------- Range operations -----------------------------
+// Address ranges are inclusive [from, to] within one register. Moves re-key
+// extracted map nodes, so values are never copied.
+struct CellMove { long long reg, addr, newReg, newAddr; };
+
+inline size_t eraseRange(Bank& b, long long reg, long long from, long long to){
+    auto itR = b.regs.find(reg);
+    if (itR==b.regs.end() || from > to) return 0;
+    auto& m = itR->second;
+    auto first = m.lower_bound(from), last = m.upper_bound(to);
+    size_t n = size_t(std::distance(first, last));
+    m.erase(first, last);
+    if (m.empty()) b.regs.erase(itR);
+    return n;
+}
+
+// Moves [from, to] of reg so that `from` lands on dstFrom in dstReg (dstReg
+// may equal reg: that is a shift). Refuses, leaving the bank untouched, when
+// a target address is held by a cell outside the moved range.
+inline bool moveRange(Bank& b, long long reg, long long from, long long to,
+                      long long dstReg, long long dstFrom,
+                      std::vector<CellMove>& moved, string& err){
+    moved.clear();
+    auto itR = b.regs.find(reg);
+    if (itR==b.regs.end() || from > to) return true;
+    auto& src = itR->second;
+    const long long delta = dstFrom - from;
+    // Validate against the bank as it is; a cell of the moved range that sits
+    // on a target address is leaving it, so only outside cells block.
+    auto itD = b.regs.find(dstReg);
+    size_t count = 0;
+    for (auto it = src.lower_bound(from); it != src.end() && it->first <= to; ++it, ++count){
+        const long long na = it->first + delta;
+        if (na < 0){ err = "move would produce a negative address"; return false; }
+        const bool leaving = dstReg == reg && na >= from && na <= to;
+        if (itD != b.regs.end() && !leaving && itD->second.count(na)){ err = "a target address is occupied"; return false; }
+    }
+    if (!count) return true;
+    using Node = std::map<long long, string>::node_type;
+    std::vector<Node> nodes;
+    for (auto it = src.lower_bound(from); it != src.end() && it->first <= to; )
+        nodes.push_back(src.extract(it++));
+    auto& dst = b.regs[dstReg]; // map references stay valid across this insert
+    for (auto& n : nodes){
+        moved.push_back({reg, n.key(), dstReg, n.key() + delta});
+        n.key() += delta;
+        dst.insert(std::move(n));
+    }
+    if (dstReg != reg && src.empty()) b.regs.erase(itR); // last use of src and dst above
+    return true;
+}
+
+// Points references to moved cells of bankId at their new homes, across every
+// bank under files/ (unloaded ones are loaded first, so none keeps a stale
+// reference). A two-part ref whose cell left register 1 becomes three-part.
+// Returns the number of references rewritten; touched banks get a new
+// revision and, when `touched` is given, are listed there for saving.
+inline size_t rewriteMovedRefs(const Config& cfg, Workspace& ws, long long bankId, const std::vector<CellMove>& moved,
+                               std::set<long long>* touched = nullptr){
+    if (moved.empty()) return 0;
+    preloadAll(cfg, ws);
+    std::map<std::pair<long long,long long>, std::pair<long long,long long>> to;
+    for (auto& m : moved) to[{m.reg, m.addr}] = {m.newReg, m.newAddr};
+    size_t total = 0;
+    for (auto& [id, bank] : ws.banks){
+        size_t inBank = 0;
+        for (auto& [rid, addrs] : bank.regs)
+            for (auto& [aid, val] : addrs){
+                auto refs = scanRefs(val, cfg);
+                for (auto r = refs.rbegin(); r != refs.rend(); ++r){
+                    if (r->bank != bankId) continue;
+                    auto hit = to.find({r->reg, r->addr});
+                    if (hit == to.end()) continue;
+                    auto [nr, na] = hit->second;
+                    string text;
+                    if (r->twoPart && nr == 1){
+                        text = string(1, cfg.prefix) + val.substr(r->pos + 1, val.find('.', r->pos) - r->pos - 1)
+                             + "." + toBaseN(na, cfg.base, cfg.widthAddr);
+                    } else {
+                        text = std::to_string(bankId) + "." + std::to_string(nr) + "." + std::to_string(na);
+                    }
+                    val.replace(r->pos, r->len, text);
+                    ++inBank;
+                }
+            }
+        if (inBank){
+            ws.touch(id); total += inBank;
+            if (touched) touched->insert(id);
+        }
+    }
+    return total;
+}
+
+// ----------------------------- Bank merge -----------------------------
+// Merges move map nodes from the source bank: whole registers are spliced in
+// when the destination lacks them, otherwise std::map::merge moves every
+// non-conflicting cell and only the conflicts are left to the policy.
+enum class MergePolicy { Overwrite, Keep, Report };
+
+inline bool parseMergePolicy(const string& s, MergePolicy& out){
+    if (s=="overwrite") { out = MergePolicy::Overwrite; return true; }
+    if (s=="keep")      { out = MergePolicy::Keep;      return true; }
+    if (s=="report")    { out = MergePolicy::Report;    return true; }
+    return false;
+}
+
+struct MergeStats {
+    size_t added = 0, replaced = 0, kept = 0;
+    std::vector<std::pair<long long,long long>> conflicts; // (reg, addr), Report only
+};
+
+// src is consumed; what is left in it afterwards is unspecified.
+inline MergeStats mergeBank(Bank& dst, Bank&& src, MergePolicy policy){
+    MergeStats st;
+    if (dst.title.empty()) dst.title = std::move(src.title);
+    for (auto it = src.regs.begin(); it != src.regs.end(); ){
+        auto cur = it++;
+        auto dIt = dst.regs.find(cur->first);
+        if (dIt == dst.regs.end()){
+            st.added += cur->second.size();
+            dst.regs.insert(src.regs.extract(cur));
+            continue;
+        }
+        auto& d = dIt->second;
+        auto& s = cur->second;
+        const size_t before = s.size();
+        d.merge(s);                       // s now holds exactly the conflicts
+        st.added += before - s.size();
+        if (policy == MergePolicy::Overwrite){
+            auto hint = d.begin();
+            for (auto& [addr, val] : s){  // both sides sorted: walk forward
+                while (hint->first < addr) ++hint;
+                hint->second = std::move(val);
+                ++st.replaced;
+            }
+        } else {
+            st.kept += s.size();
+            if (policy == MergePolicy::Report)
+                for (auto& [addr, val] : s) st.conflicts.push_back({cur->first, addr});
+        }
+    }
+    return st;
+}
+
+// Expands '*' and '?' in the file-name part of pattern (directories are
+// taken literally). A pattern without wildcards is returned as-is.
+inline bool globMatch(const char* p, const char* s){
+    for (; *p; ++p, ++s){
+        if (*p=='*'){
+            for (const char* t = s; ; ++t){ if (globMatch(p+1, t)) return true; if (!*t) return false; }
+        }
+        if (!*s || (*p!='?' && *p!=*s)) return false;
+    }
+    return !*s;
+}
+
+inline std::vector<fs::path> expandGlob(const string& pattern){
+    fs::path pat(pattern);
+    string name = pat.filename().string();
+    if (name.find_first_of("*?") == string::npos) return {pat};
+    fs::path dir = pat.has_parent_path()? pat.parent_path() : fs::path(".");
+    std::vector<fs::path> out;
+    std::error_code ec;
+    for (auto& e : fs::directory_iterator(dir, ec)){
+        if (!e.is_regular_file()) continue;
+        if (globMatch(name.c_str(), e.path().filename().string().c_str())) out.push_back(e.path());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+// ----------------------------- Diff -----------------------------
+// Banks are diffed register by register in key order. Each register first
+// gets a 64-bit digest (computed in parallel); registers whose size and
+// digest match on both sides are skipped without a cell walk. A side that
+// names its workspace bank reuses that workspace's digests until the
+// register is next touched (see Workspace::generation).
+enum class DiffKind { Added, Removed, Changed };
+struct CellDiff {
+    DiffKind kind;
+    long long reg, addr;
+    string before, after; // before empty for Added, after empty for Removed
+};
+struct DiffStats { size_t added = 0, removed = 0, changed = 0, regsSkipped = 0; };
+struct DigestSource { Workspace* ws = nullptr; long long bank = 0; }; // where a side's bank lives, if anywhere
+
+inline unsigned long long registerDigest(const std::map<long long, string>& addrs){
+    unsigned long long h = 1469598103934665603ull;        // FNV-1a
+    auto mix = [&h](const void* p, size_t n){
+        auto* c = static_cast<const unsigned char*>(p);
+        for (size_t i=0; i<n; ++i){ h ^= c[i]; h *= 1099511628211ull; }
+    };
+    for (auto& [addr, val] : addrs){
+        mix(&addr, sizeof addr);
+        size_t n = val.size(); mix(&n, sizeof n);
+        mix(val.data(), n);
+    }
+    return h;
+}
+
+inline std::vector<CellDiff> diffBanks(const Bank& a, const Bank& b, DiffStats& st,
+                                       DigestSource da = {}, DigestSource db = {}){
+    using Reg = std::map<long long, string>;
+    // Pair up registers present on both sides and digest them in parallel,
+    // except those whose digest is cached at the register's current generation.
+    struct Side { const Reg* reg; unsigned long long digest = 0; bool known = false; };
+    std::vector<std::pair<long long, std::array<Side, 2>>> shared;
+    for (auto& [rid, addrs] : a.regs)
+        if (auto it = b.regs.find(rid); it != b.regs.end() && it->second.size()==addrs.size())
+            shared.push_back({rid, {Side{&addrs}, Side{&it->second}}});
+    const DigestSource src[2] = {da, db};
+    for (auto& [rid, sides] : shared)
+        for (int s = 0; s < 2; ++s){
+            if (!src[s].ws) continue;
+            auto it = src[s].ws->digests.find({src[s].bank, rid});
+            if (it == src[s].ws->digests.end() || it->second.first != src[s].ws->generation(src[s].bank, rid)) continue;
+            sides[s].digest = it->second.second; sides[s].known = true;
+        }
+    parallelFor(shared.size(), [&](size_t lo, size_t hi){
+        for (size_t i=lo; i<hi; ++i)
+            for (auto& side : shared[i].second) if (!side.known) side.digest = registerDigest(*side.reg);
+    }, 4);
+    std::unordered_set<const Reg*> skip;
+    for (auto& [rid, sides] : shared){
+        for (int s = 0; s < 2; ++s)
+            if (src[s].ws && !sides[s].known)
+                src[s].ws->digests[{src[s].bank, rid}] = {src[s].ws->generation(src[s].bank, rid), sides[s].digest};
+        if (sides[0].digest == sides[1].digest) skip.insert(sides[0].reg);
+    }
+    st.regsSkipped += skip.size();
+
+    std::vector<CellDiff> out;
+    auto all = [&](long long rid, const Reg& m, DiffKind k){
+        for (auto& [aid, v] : m){
+            if (k==DiffKind::Added) { out.push_back({k, rid, aid, {}, v}); ++st.added; }
+            else                    { out.push_back({k, rid, aid, v, {}}); ++st.removed; }
+        }
+    };
+    auto ra = a.regs.begin(), rb = b.regs.begin();
+    while (ra != a.regs.end() || rb != b.regs.end()){
+        if (rb == b.regs.end() || (ra != a.regs.end() && ra->first < rb->first)){ all(ra->first, ra->second, DiffKind::Removed); ++ra; continue; }
+        if (ra == a.regs.end() || rb->first < ra->first){ all(rb->first, rb->second, DiffKind::Added); ++rb; continue; }
+        if (!skip.count(&ra->second)){
+            const long long rid = ra->first;
+            auto ca = ra->second.begin(), ea = ra->second.end();
+            auto cb = rb->second.begin(), eb = rb->second.end();
+            while (ca != ea || cb != eb){
+                if (cb == eb || (ca != ea && ca->first < cb->first)){ out.push_back({DiffKind::Removed, rid, ca->first, ca->second, {}}); ++st.removed; ++ca; }
+                else if (ca == ea || cb->first < ca->first){ out.push_back({DiffKind::Added, rid, cb->first, {}, cb->second}); ++st.added; ++cb; }
+                else {
+                    if (ca->second != cb->second){ out.push_back({DiffKind::Changed, rid, ca->first, ca->second, cb->second}); ++st.changed; }
+                    ++ca; ++cb;
+                }
+            }
+        }
+        ++ra; ++rb;
+    }
+    return out;
+}
+
+// Copy of a bank with every value replaced by its resolved text.
+inline Bank resolvedBank(const Config& cfg, Workspace& ws, long long bankId, bool autoload = true){
+    Resolver R(cfg, ws);
+    R.autoload = autoload;
+    Bank out;
+    auto it = ws.banks.find(bankId);
+    if (it == ws.banks.end()) return out;
+    out.id = it->second.id; out.title = it->second.title;
+    for (auto& [rid, addrs] : it->second.regs)
+        for (auto& [aid, val] : addrs){
+            std::unordered_set<string> visited;
+            out.regs[rid][aid] = R.resolve(val, bankId, visited);
+        }
+    return out;
+}
+
+// (bank id, path) of every <prefix><id>.txt directly under dir, by id.
+inline std::vector<std::pair<long long, fs::path>> contextFilesIn(const Config& cfg, const fs::path& dir){
+    std::vector<std::pair<long long, fs::path>> files;
+    std::error_code ec;
+    for (auto& entry : fs::directory_iterator(dir, ec)){
+        if (!entry.is_regular_file() || entry.path().extension() != ".txt") continue;
+        string stem = entry.path().stem().string();
+        long long id;
+        if (stem.empty() || stem[0]!=cfg.prefix || !parseIntBase(stem.substr(1), cfg.base, id)) continue;
+        files.push_back({id, entry.path()});
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// Loads every <prefix><id>.txt under dir into a fresh workspace, parsing the
+// files in parallel. Files that fail to parse are reported in errs.
+inline Workspace loadWorkspaceDir(const Config& cfg, const fs::path& dir, std::vector<string>& errs){
+    auto files = contextFilesIn(cfg, dir);
+    std::vector<Bank> banks(files.size());
+    std::vector<string> err(files.size());
+    parallelFor(files.size(), [&](size_t b, size_t e){
+        for (size_t i=b; i<e; ++i) (void)loadContextFile(cfg, files[i].second, banks[i], err[i]);
+    }, 1);
+    Workspace out;
+    for (size_t i=0; i<files.size(); ++i){
+        if (!err[i].empty()){ errs.push_back(files[i].second.string()+": "+err[i]); continue; }
+        out.filenames[files[i].first] = files[i].second.string();
+        out.banks[files[i].first] = std::move(banks[i]);
+    }
+    return out;
+}
+
+// ----------------------------- Bank dependencies -----------------------------
+// What a bank's resolved output can depend on, read statically: the banks its
+// values reference, the files they include, and the banks referenced inside
+// those files (the Resolver expands references in included text too).
+struct BankUses {
+    std::set<long long> banks;
+    std::set<string> files; // names relative to files/, as written in @file(...)
+};
+
+inline BankUses bankUses(const Config& cfg, const Bank& b){
+    static const std::regex fileRe(R"(@file\(([^)]+)\))");
+    BankUses u;
+    auto refsIn = [&](const string& text){ for (auto& r : scanRefs(text, cfg)) u.banks.insert(r.bank); };
+    for (auto& [rid, addrs] : b.regs)
+        for (auto& [aid, val] : addrs){
+            refsIn(val);
+            for (auto it = std::sregex_iterator(val.begin(), val.end(), fileRe); it != std::sregex_iterator(); ++it){
+                string name = trim((*it)[1].str());
+                if (!u.files.insert(name).second) continue;
+                const fs::path path = fs::path("files") / name;
+                if (scanInclude(cfg, path).plain) continue; // nothing in it could be a reference
+                std::ifstream in(path, std::ios::binary);
+                for (string line; std::getline(in, line);) refsIn(line); // references never span lines
+            }
+        }
+    u.banks.erase(b.id);
+    return u;
+}
+
+// Banks whose resolved output may change when the given banks or include
+// files change: the banks themselves plus everything that reaches them
+// through references, transitively.
+inline std::set<long long> affectedBanks(const std::map<long long, BankUses>& uses,
+                                         const std::set<long long>& banks, const std::set<string>& files){
+    std::map<long long, std::vector<long long>> users; // bank -> banks referencing it
+    for (auto& [id, u] : uses) for (long long b : u.banks) users[b].push_back(id);
+    std::set<long long> out(banks.begin(), banks.end());
+    for (auto& [id, u] : uses)
+        for (auto& f : files) if (u.files.count(f)){ out.insert(id); break; }
+    std::vector<long long> todo(out.begin(), out.end());
+    while (!todo.empty()){
+        long long b = todo.back(); todo.pop_back();
+        auto it = users.find(b);
+        if (it == users.end()) continue;
+        for (long long u : it->second) if (out.insert(u).second) todo.push_back(u);
+    }
+    return out;
+}
+
+// ----------------------------- Hotspot analysis -----------------------------
+// Per-cell reference statistics over all loaded banks. References are scanned
+// in parallel; depth and resolved size then come from one memoized walk of
+// the reference graph. resolvedSize is an estimate: each reference to an
+// existing cell is replaced by that cell's estimated size, missing references
+// and @file(...) spans count as written, and a cycle as a short marker.
+// Sizes saturate instead of overflowing on heavily shared sub-graphs.
+struct CellStats {
+    long long bank = 0, reg = 0, addr = 0;
+    size_t fanIn = 0, fanOut = 0;   // references to / from this cell
+    size_t depth = 0;               // longest reference chain below this cell
+    size_t resolvedSize = 0;
+};
+
+inline std::vector<CellStats> analyzeHotspots(const Config& cfg, const Workspace& ws){
+    std::vector<CellStats> cells;
+    std::vector<const string*> vals;
+    for (auto& [bid, b] : ws.banks)
+        for (auto& [rid, addrs] : b.regs)
+            for (auto& [aid, val] : addrs){
+                CellStats c; c.bank = bid; c.reg = rid; c.addr = aid;
+                cells.push_back(c); vals.push_back(&val);
+            }
+    // cells is in (bank, reg, addr) order, so lookups are a binary search.
+    auto indexOf = [&](long long b, long long r, long long a) -> size_t {
+        auto key = std::tie(b, r, a);
+        auto it = std::lower_bound(cells.begin(), cells.end(), key, [](const CellStats& c, const auto& k){
+            return std::tie(c.bank, c.reg, c.addr) < k;
+        });
+        return (it != cells.end() && std::tie(it->bank, it->reg, it->addr) == key)? size_t(it - cells.begin()) : cells.size();
+    };
+    const size_t n = cells.size();
+    std::vector<std::vector<size_t>> edges(n);  // existing targets, one per reference
+    std::vector<size_t> ownSize(n);             // value size minus reference spans
+    parallelFor(n, [&](size_t lo, size_t hi){
+        for (size_t i=lo; i<hi; ++i){
+            auto refs = scanRefs(*vals[i], cfg);
+            cells[i].fanOut = refs.size();
+            size_t own = vals[i]->size();
+            for (auto& r : refs){
+                size_t t = indexOf(r.bank, r.reg, r.addr);
+                if (t < n){ edges[i].push_back(t); own -= r.len; }
+            }
+            ownSize[i] = own;
+        }
+    }, 256);
+    for (auto& e : edges) for (size_t t : e) ++cells[t].fanIn;
+
+    // Iterative post-order DFS; an edge back into the open path is a cycle.
+    enum : char { Fresh, Open, Done };
+    std::vector<char> state(n, Fresh);
+    std::vector<std::pair<size_t,size_t>> stack; // (cell, next edge)
+    for (size_t root=0; root<n; ++root){
+        if (state[root] != Fresh) continue;
+        stack.push_back({root, 0}); state[root] = Open;
+        while (!stack.empty()){
+            auto& [c, e] = stack.back();
+            if (e < edges[c].size()){
+                size_t t = edges[c][e++];
+                if (state[t] == Fresh){ state[t] = Open; stack.push_back({t, 0}); }
+                continue;
+            }
+            size_t depth = 0, size = ownSize[c];
+            for (size_t t : edges[c]){
+                size_t add = 16; // cycle marker
+                if (state[t] == Done){ depth = std::max(depth, cells[t].depth + 1); add = cells[t].resolvedSize; }
+                size = add > std::numeric_limits<size_t>::max() - size? std::numeric_limits<size_t>::max() : size + add;
+            }
+            cells[c].depth = depth; cells[c].resolvedSize = size;
+            state[c] = Done;
+            stack.pop_back();
+        }
+    }
+    return cells;
+}
+
+// ----------------------------- Publishing an image -----------------------------
+// Writes every bank of ws (preload first for a full snapshot) as a
+// WorkspaceImage. The file is written beside its target and renamed into
+// place, so processes attached to an older image keep their mapping.
+inline bool publishWorkspace(const Config& cfg, const Workspace& ws, const fs::path& path, string& err){
+    ImageHeader h{};
+    std::memcpy(h.magic, kImageMagic, sizeof kImageMagic);
+    h.version = kImageVersion; h.base = cfg.base; h.prefix = cfg.prefix;
+    std::vector<ImageBank> banks;
+    std::vector<ImageCell> cells;
+    std::vector<uint64_t> bloomWords;
+    string blob;
+    std::unordered_map<std::string_view, uint64_t> valueOff; // identical values are stored once
+    for (auto& [id, b] : ws.banks){
+        auto bloom = BankBloom::build(b);
+        ImageBank ib{id, cells.size(), 0, blob.size(), b.title.size(), bloomWords.size(), bloom.words.size()};
+        bloomWords.insert(bloomWords.end(), bloom.words.begin(), bloom.words.end());
+        blob += b.title;
+        for (auto& [rid, addrs] : b.regs)
+            for (auto& [aid, val] : addrs){
+                auto [it, fresh] = valueOff.try_emplace(val, blob.size());
+                if (fresh) blob += val;
+                cells.push_back({rid, aid, it->second, val.size()});
+            }
+        ib.cellCount = cells.size() - ib.firstCell;
+        banks.push_back(ib);
+    }
+    h.banks = banks.size(); h.cells = cells.size();
+    h.bankOff = sizeof h;
+    h.cellOff = h.bankOff + banks.size() * sizeof(ImageBank);
+    const uint64_t bloomBase = h.cellOff + cells.size() * sizeof(ImageCell);
+    for (auto& ib : banks) ib.bloomOff = bloomBase + ib.bloomOff * sizeof(uint64_t);
+    h.strOff  = bloomBase + bloomWords.size() * sizeof(uint64_t);
+    h.strSize = blob.size();
+    const fs::path tmp = uniqueTempPath(path);
+    std::error_code ec;
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out){ err = "cannot write " + tmp.string(); return false; }
+        out.write(reinterpret_cast<const char*>(&h), sizeof h);
+        out.write(reinterpret_cast<const char*>(banks.data()), std::streamsize(banks.size() * sizeof(ImageBank)));
+        out.write(reinterpret_cast<const char*>(cells.data()), std::streamsize(cells.size() * sizeof(ImageCell)));
+        out.write(reinterpret_cast<const char*>(bloomWords.data()), std::streamsize(bloomWords.size() * sizeof(uint64_t)));
+        out.write(blob.data(), std::streamsize(blob.size()));
+        if (!out){ out.close(); fs::remove(tmp, ec); err = "write failed: " + tmp.string(); return false; }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec){ err = ec.message(); fs::remove(tmp, ec); return false; }
+    return true;
+}
+
+// Attaches ws to an image published with the same prefix and base.
+inline bool attachWorkspace(const Config& cfg, Workspace& ws, const fs::path& path, string& err){
+    auto img = WorkspaceImage::open(path, err);
+    if (!img) return false;
+    if (img->prefix() != cfg.prefix || img->numberBase() != cfg.base){
+        err = "image was published with a different prefix/base"; return false;
+    }
+    ws.image = std::move(img);
+    return true;
+}
+
 } // namespace scripted
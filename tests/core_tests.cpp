@@ -0,0 +1,408 @@
+// core_tests.cpp — checks for scripted_core.hpp
+// g++ -std=c++23 -O1 -fsanitize=address,undefined -I. tests/core_tests.cpp -o core_tests && ./core_tests
+#include "scripted_core.hpp"
+#include <iostream>
+
+using namespace scripted;
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { ++failures; std::cerr << __FILE__ << ":" << __LINE__ << ": " #cond "\n"; } } while (0)
+
+// Shifting a register that is empty (":del" leaves one behind) is a no-op.
+static void moveRangeEmptyRegister(){
+    Bank b; b.id = 1;
+    b.regs[1]; // empty register 1
+    b.regs[2][1] = "two";
+    std::vector<CellMove> moved; string err;
+    CHECK(moveRange(b, 1, 0, std::numeric_limits<long long>::max(), 1, 5, moved, err));
+    CHECK(moved.empty());
+    CHECK(b.regs.count(2) && b.regs[2].size() == 1);
+}
+
+// A shift within one register keeps the register and lands every cell.
+static void moveRangeSameRegister(){
+    Bank b; b.id = 1;
+    for (long long a = 1; a <= 4; ++a) b.regs[1][a] = "v" + std::to_string(a);
+    std::vector<CellMove> moved; string err;
+    CHECK(moveRange(b, 1, 2, 4, 1, 3, moved, err)); // overlaps its own range
+    CHECK(moved.size() == 3);
+    CHECK(b.regs.count(1) && b.regs[1].size() == 4);
+    CHECK(b.regs[1][1] == "v1" && b.regs[1][3] == "v2" && b.regs[1][5] == "v4");
+    CHECK(!b.regs[1].count(2));
+}
+
+// A refused move leaves the bank as it was and creates no register.
+static void moveRangeRefused(){
+    Bank b; b.id = 1;
+    b.regs[1][1] = "a"; b.regs[1][2] = "b";
+    std::vector<CellMove> moved; string err;
+    CHECK(!moveRange(b, 1, 1, 1, 1, 2, moved, err));
+    CHECK(!err.empty());
+    CHECK(b.regs[1].size() == 2 && b.regs[1][1] == "a");
+    CHECK(!moveRange(b, 1, 1, 2, 3, -1, moved, err));
+    CHECK(!b.regs.count(3));
+}
+
+// Moving a whole register elsewhere drops the emptied source register.
+static void moveRangeOtherRegister(){
+    Bank b; b.id = 1;
+    b.regs[1][1] = "a"; b.regs[1][2] = "b";
+    std::vector<CellMove> moved; string err;
+    CHECK(moveRange(b, 1, 1, 2, 2, 10, moved, err));
+    CHECK(!b.regs.count(1));
+    CHECK(b.regs[2].size() == 2 && b.regs[2][10] == "a" && b.regs[2][11] == "b");
+}
+
+static string resolveCell(const Config& cfg, Workspace& ws, long long bank, long long reg, long long addr){
+    Resolver R(cfg, ws); R.autoload = false;
+    std::unordered_set<string> visited;
+    return R.resolve(ws.banks[bank].regs[reg][addr], bank, visited);
+}
+
+// The x<bank>.<addr> pass rescans what b.r.a substituted, joined with the
+// text around it, as the single-string resolver did.
+static void resolveRescansSubstitutions(){
+    Config cfg; Workspace ws;
+    ws.banks[1].id = 1; ws.banks[2].id = 2; ws.banks[3].id = 3;
+    ws.banks[1].regs[1][1] = "2.1.1.5 tail";
+    ws.banks[1].regs[1][2] = "2.1.2";
+    ws.banks[2].regs[1][1] = "x3";
+    ws.banks[2].regs[1][2] = "x00009.0001";
+    ws.banks[3].regs[1][5] = "THREE-FIVE";
+    CHECK(resolveCell(cfg, ws, 1, 1, 1) == "THREE-FIVE tail");
+    CHECK(resolveCell(cfg, ws, 1, 1, 2) == "[Missing [Missing x00009.0001]]");
+}
+
+// A value that met a cycle is not memoised, so each cell reports its own loop.
+static void resolveCycles(){
+    Config cfg; Workspace ws;
+    ws.banks[1].id = 1;
+    ws.banks[1].regs[1][4] = "1.1.5";
+    ws.banks[1].regs[1][5] = "1.1.4 loop";
+    Resolver R(cfg, ws); R.autoload = false;
+    std::unordered_set<string> visited;
+    CHECK(R.resolve(ws.banks[1].regs[1][4], 1, visited) == "[Circular Ref: 1.1.5] loop");
+    CHECK(R.resolve(ws.banks[1].regs[1][5], 1, visited) == "[Circular Ref: 1.1.4] loop loop");
+}
+
+// An include reached through a b.r.a reference stays a file span unless its
+// edge could join the text now around it.
+static void resolveKeepsNestedIncludes(){
+    const fs::path dir = fs::temp_directory_path() / ("core_tests_inc_" + std::to_string(::getpid()));
+    fs::create_directories(dir / "files");
+    { std::ofstream(dir / "files" / "big.txt") << "BIG CONTENT\n"; }
+    { std::ofstream(dir / "files" / "d.txt") << "2"; }
+    const fs::path old = fs::current_path();
+    fs::current_path(dir);
+    Config cfg; Workspace ws;
+    ws.banks[1].id = 1;
+    ws.banks[1].regs[1][1] = "@file(big.txt)";
+    ws.banks[1].regs[1][5] = "@file(d.txt)";
+    Resolver R(cfg, ws); R.autoload = false;
+    ResolveTrace t; R.trace = &t;
+    std::unordered_set<string> visited;
+    auto rope = R.resolveRope("see 1.1.1 end", 1, visited);
+    size_t files = 0;
+    rope->visit([](std::string_view){}, [&](const fs::path&, uint64_t, uint64_t){ ++files; });
+    CHECK(files == 1 && t.spliced);
+    CHECK(rope->flatten() == "see BIG CONTENT\n end");
+    CHECK(R.resolve("x1.1.5.3", 1, visited) == "[Missing x2.3]"); // "x" + "2" + ".3" joins
+    R.trace = nullptr;
+    fs::current_path(old);
+    fs::remove_all(dir);
+}
+
+// A bank missing from both the image and files/ is not left behind empty.
+static void imageMissLoadsNothing(){
+    Config cfg; Workspace src;
+    src.banks[1].id = 1; src.banks[1].regs[1][1] = "one";
+    const fs::path path = fs::temp_directory_path() / ("core_tests_" + std::to_string(::getpid()) + ".img");
+    string err;
+    CHECK(publishWorkspace(cfg, src, path, err));
+    Workspace ws; ws.image = WorkspaceImage::open(path, err);
+    CHECK(ws.image);
+    CHECK(ensureBankLoadedInWorkspace(cfg, ws, 1, err));
+    CHECK(ws.banks.count(1) && ws.banks[1].regs[1][1] == "one");
+    CHECK(!ensureBankLoadedInWorkspace(cfg, ws, 99999, err));
+    CHECK(!ws.banks.count(99999));
+    ws.image.reset();
+    fs::remove(path);
+}
+
+// A bank held only by the attached image is resolved in place, not copied out.
+static void imageBankResolvesInPlace(){
+    Config cfg; Workspace src;
+    src.banks[1].id = 1; src.banks[1].title = "one";
+    src.banks[1].regs[1][1] = "see 1.1.2"; src.banks[1].regs[1][2] = "two";
+    src.banks[1].regs[2][1] = "x00001.0002";
+    const fs::path path = fs::temp_directory_path() / ("core_tests_" + std::to_string(::getpid()) + "_inplace.img");
+    string err;
+    CHECK(publishWorkspace(cfg, src, path, err));
+    Workspace ws;
+    CHECK(attachWorkspace(cfg, ws, path, err));
+    CHECK(resolveBankToText(cfg, ws, 1) == resolveBankToText(cfg, src, 1));
+    CHECK(resolveBankToText(cfg, ws, 1) == "x00001\t(one){\n01\n\t0001\tsee two\n\t0002\ttwo\n02\n\t0001\ttwo\n}\n");
+    CHECK(ws.banks.empty());
+    ws.image.reset();
+    fs::remove(path);
+}
+
+// Watchers skip exactly the names uniqueTempPath hands out.
+static void tempNames(){
+    CHECK(isTempName(uniqueTempPath("files/x00001.txt")));
+    CHECK(isTempName(uniqueTempPath("files/.cache/x00001.rcache")));
+    CHECK(!isTempName("files/x00001.txt"));
+    CHECK(!isTempName("files/notes.tmpl"));
+}
+
+// Cached register digests are reused until touch/touchCell drops them.
+static void diffDigestCache(){
+    Workspace ws;
+    ws.banks[1].regs[1][1] = "a"; ws.banks[1].regs[2][1] = "b";
+    ws.banks[2].regs[1][1] = "a"; ws.banks[2].regs[2][1] = "b";
+    DiffStats st;
+    CHECK(diffBanks(ws.banks[1], ws.banks[2], st, {&ws, 1}, {&ws, 2}).empty());
+    CHECK(st.regsSkipped == 2 && ws.digests.size() == 4);
+    ws.banks[2].regs[2][1] = "c"; ws.touchCell(2, 2, 1);
+    CHECK(ws.digests.size() == 3 && ws.digests.at({2, 1}).first == ws.generation(2, 1));
+    st = {};
+    auto d = diffBanks(ws.banks[1], ws.banks[2], st, {&ws, 1}, {&ws, 2});
+    CHECK(d.size() == 1 && st.changed == 1 && st.regsSkipped == 1);
+    // White-box: register 1 changes without a touch; a reused digest still skips it.
+    ws.banks[2].regs[1][1] = "untracked";
+    ws.banks[2].regs[2][1] = "d"; ws.touchCell(2, 2, 1);
+    st = {};
+    d = diffBanks(ws.banks[1], ws.banks[2], st, {&ws, 1}, {&ws, 2});
+    CHECK(d.size() == 1 && d[0].reg == 2 && st.regsSkipped == 1);
+    ws.banks[2].regs[1][1] = "a";
+    ws.banks[1].regs[1][1] = "z"; ws.touch(1);
+    CHECK(!ws.digests.count({1, 1}) && !ws.digests.count({1, 2}) && ws.digests.count({2, 1}));
+    st = {};
+    CHECK(diffBanks(ws.banks[1], ws.banks[2], st, {&ws, 1}, {&ws, 2}).size() == 2);
+}
+
+// A Bloom filter older than its bank is ignored rather than hiding new cells.
+static void bloomFailsOpen(){
+    Workspace ws;
+    ws.banks[1].id = 1; ws.banks[1].regs[1][1] = "a";
+    ws.buildBloom(1);
+    string v;
+    CHECK(ws.bloom(1) && !lookupCell(ws, nullptr, 1, 1, 2, v));
+    ws.banks[1].regs[1][2] = "b"; ws.touchCell(1, 1, 2); // kept current
+    CHECK(ws.bloom(1) && lookupCell(ws, nullptr, 1, 1, 2, v) && v == "b");
+    ws.banks[1].regs[3][7] = "c"; ++ws.revisions[1];     // edited behind the filter's back
+    CHECK(!ws.bloom(1) && lookupCell(ws, nullptr, 1, 3, 7, v) && v == "c");
+    ws.banks[1].regs[4][4] = "d"; ws.touchCell(1, 4, 4); // stale filter stays stale
+    CHECK(!ws.bloom(1) && lookupCell(ws, nullptr, 1, 4, 4, v) && v == "d");
+    ws.buildBloom(1);
+    CHECK(ws.bloom(1) && lookupCell(ws, nullptr, 1, 3, 7, v) && !lookupCell(ws, nullptr, 1, 5, 5, v));
+}
+
+// Merges move cells the destination lacks; conflicts follow the policy.
+static void mergePolicies(){
+    auto sides = [](Bank& dst, Bank& src){
+        dst = {}; src = {};
+        dst.regs[1][1] = "d1"; dst.regs[1][3] = "d3";
+        src.title = "src";
+        src.regs[1][1] = "s1"; src.regs[1][2] = "s2"; src.regs[1][3] = "s3";
+        src.regs[2][7] = "s7"; // register dst lacks: spliced whole
+    };
+    Bank dst, src;
+    sides(dst, src);
+    auto st = mergeBank(dst, std::move(src), MergePolicy::Overwrite);
+    CHECK(st.added == 2 && st.replaced == 2 && st.kept == 0 && st.conflicts.empty());
+    CHECK(dst.regs[1][1] == "s1" && dst.regs[1][2] == "s2" && dst.regs[1][3] == "s3" && dst.regs[2][7] == "s7");
+    CHECK(dst.title == "src");
+
+    sides(dst, src);
+    st = mergeBank(dst, std::move(src), MergePolicy::Keep);
+    CHECK(st.added == 2 && st.replaced == 0 && st.kept == 2 && st.conflicts.empty());
+    CHECK(dst.regs[1][1] == "d1" && dst.regs[1][2] == "s2" && dst.regs[1][3] == "d3" && dst.regs[2][7] == "s7");
+
+    sides(dst, src);
+    st = mergeBank(dst, std::move(src), MergePolicy::Report);
+    CHECK(st.kept == 2 && dst.regs[1][1] == "d1");
+    CHECK((st.conflicts == std::vector<std::pair<long long,long long>>{{1, 1}, {1, 3}}));
+
+    MergePolicy p;
+    CHECK(parseMergePolicy("keep", p) && p == MergePolicy::Keep);
+    CHECK(!parseMergePolicy("newest", p));
+}
+
+// Overlays read through to the base and keep their writes to themselves
+// until committed.
+static void overlayCopyOnWrite(){
+    Config cfg; Workspace ws;
+    ws.banks[1].id = 1;
+    ws.banks[1].regs[1][1] = "base"; ws.banks[1].regs[1][2] = "keep"; ws.banks[1].regs[1][3] = "see 1.1.1";
+    Overlay a, b;
+    a.set(1, 1, 1, "a-edit"); a.erase(1, 1, 2); a.set(1, 1, 9, "a-new");
+    b.set(1, 1, 1, "b-edit");
+    string v;
+    CHECK(lookupCell(ws, &a, 1, 1, 1, v) && v == "a-edit");
+    CHECK(!lookupCell(ws, &a, 1, 1, 2, v));                 // deletion hides the base cell
+    CHECK(lookupCell(ws, &a, 1, 1, 3, v) && v == "see 1.1.1"); // untouched: read through
+    CHECK(lookupCell(ws, &b, 1, 1, 1, v) && v == "b-edit");
+    CHECK(lookupCell(ws, &b, 1, 1, 2, v) && v == "keep");
+    CHECK(lookupCell(ws, nullptr, 1, 1, 1, v) && v == "base");
+    CHECK(ws.banks[1].regs[1].size() == 3 && ws.revision(1) == 0);
+
+    Resolver R(cfg, ws); R.autoload = false; R.overlay = &a;
+    std::unordered_set<string> visited;
+    CHECK(R.resolve("see 1.1.1", 1, visited) == "see a-edit");
+    Bank seen = overlaidBank(ws, a, 1);
+    CHECK(seen.regs[1].size() == 3 && seen.regs[1][9] == "a-new" && !seen.regs[1].count(2));
+
+    CHECK(commitOverlay(ws, a) == 3 && a.empty());
+    CHECK(ws.revision(1) == 1 && ws.banks[1].regs[1][1] == "a-edit" && !ws.banks[1].regs[1].count(2));
+    CHECK(lookupCell(ws, &b, 1, 1, 9, v) && v == "a-new");
+}
+
+// Frozen banks find every cell, through the dense tables and the perfect
+// hash alike, and report misses (including keys that collide in the hash).
+static void frozenLookup(){
+    Bank b; b.id = 1;
+    for (long long a = 1; a <= 50; ++a) if (a != 25) b.regs[1][a] = "d" + std::to_string(a); // dense, one hole
+    for (long long i = 0; i < 3000; ++i){                                                     // sparse: hashed
+        const long long a = i * 7919 + 13;
+        b.regs[2 + i % 3][a] = i % 2? "short" + std::to_string(i) : string(40, 'v') + std::to_string(i);
+    }
+    b.regs[9]; // empty register
+    auto f = FrozenBank::build(b);
+    CHECK(f);
+    if (!f) return;
+    size_t cells = 0;
+    for (auto& [rid, addrs] : b.regs) cells += addrs.size();
+    CHECK(f->size() == cells && f->registers() == b.regs.size());
+    std::string_view v;
+    bool all = true;
+    for (auto& [rid, addrs] : b.regs)
+        for (auto& [aid, val] : addrs) all = all && f->find(rid, aid, v) && v == val;
+    CHECK(all);
+    CHECK(!f->find(1, 25, v) && !f->find(1, 0, v) && !f->find(1, 51, v)); // dense hole and edges
+    bool none = true;
+    for (long long i = 0; i < 3000; ++i) none = none && !f->find(2 + i % 3, i * 7919 + 14, v);
+    CHECK(none);
+    CHECK(!f->find(7, 13, v) && !f->find(9, 1, v));
+    CHECK(!f->find(2, (1LL << 40) + 13, v) && !f->find(-1, 13, v));
+    size_t walked = 0; bool ordered = true; long long lastReg = -1, lastAddr = -1;
+    f->forEach([](long long){}, [&](long long r, long long a, std::string_view val){
+        ordered = ordered && std::pair(r, a) > std::pair(lastReg, lastAddr) && val == b.regs[r][a];
+        lastReg = r; lastAddr = a; ++walked;
+    });
+    CHECK(walked == cells && ordered);
+}
+
+// The intern pool stores each distinct value once and its views stay put.
+static void internDedup(){
+    InternPool pool;
+    const string big(20000, 'b'); // past the chunk threshold: a block of its own
+    auto a = pool.intern("hello"), b = pool.intern(string("hel") + "lo"), c = pool.intern("world");
+    auto l1 = pool.intern(big), l2 = pool.intern(string(big));
+    CHECK(a == "hello" && a.data() == b.data() && c.data() != a.data());
+    CHECK(l1 == big && l1.data() == l2.data());
+    std::vector<std::string_view> many;
+    for (int i = 0; i < 20000; ++i) many.push_back(pool.intern("value-" + std::to_string(i))); // several chunks
+    bool stable = a == "hello" && c == "world";
+    for (int i = 0; i < 20000; ++i) stable = stable && many[size_t(i)] == "value-" + std::to_string(i);
+    CHECK(stable && pool.intern("value-7").data() == many[7].data());
+    auto st = pool.stats();
+    CHECK(st.values == 20006 && st.unique == 20003);
+    CHECK(st.bytes == st.uniqueBytes + 5 + big.size() + 7);
+
+    // Frozen banks sharing a pool hold one copy of a long value between them.
+    auto shared = std::make_shared<InternPool>();
+    Bank x, y; x.regs[1][1] = big; y.regs[4][2] = big;
+    auto fx = FrozenBank::build(x, shared), fy = FrozenBank::build(y, shared);
+    std::string_view vx, vy;
+    CHECK(fx && fy && fx->find(1, 1, vx) && fy->find(4, 2, vy) && vx.data() == vy.data());
+    CHECK(shared->stats().unique == 1);
+
+    std::map<long long, Bank> banks{{1, x}, {2, y}};
+    auto ds = dedupStats(banks);
+    CHECK(ds.values == 2 && ds.unique == 1 && ds.ratio() == 2.0);
+}
+
+// Cells keep 32-bit ids: a bank whose ids do not fit is left unfrozen, and
+// values at the inline limit and just past it both read back.
+static void compactCellRange(){
+    const long long top = (long long)UINT32_MAX;
+    Bank edge; edge.regs[top][top] = "max"; edge.regs[0][0] = "zero";
+    edge.regs[1][1] = string(12, 's'); edge.regs[1][2] = string(13, 'p');
+    auto f = FrozenBank::build(edge);
+    std::string_view v;
+    CHECK(f && f->find(top, top, v) && v == "max" && f->find(0, 0, v) && v == "zero");
+    CHECK(f && f->find(1, 1, v) && v == string(12, 's') && f->find(1, 2, v) && v == string(13, 'p'));
+    CHECK(f && !f->find(top + 1, top, v) && !f->find(top, top + 1, v));
+
+    Bank wideReg; wideReg.regs[top + 1][1] = "r";
+    Bank wideAddr; wideAddr.regs[1][0] = "ok"; wideAddr.regs[1][top + 1] = "a";
+    Bank negAddr; negAddr.regs[1][-1] = "n";
+    CHECK(!FrozenBank::build(wideReg) && !FrozenBank::build(wideAddr) && !FrozenBank::build(negAddr));
+
+    Workspace ws;
+    ws.banks[1] = wideAddr;
+    ws.freeze(1);
+    CHECK(!ws.frozen.count(1));
+    string s;
+    CHECK(lookupCell(ws, nullptr, 1, 1, top + 1, s) && s == "a"); // still served from the map
+}
+
+// Cached resolutions are reused across runs until a cell or include they
+// read changes.
+static void resolveCacheInvalidation(){
+    const fs::path dir = fs::temp_directory_path() / ("core_tests_cache_" + std::to_string(::getpid()));
+    fs::create_directories(dir / "files");
+    { std::ofstream(dir / "files" / "inc.txt") << "inc 2.1.1"; } // holds a reference: read, not spliced
+    const fs::path old = fs::current_path();
+    fs::current_path(dir);
+    Config cfg;
+    auto run = [&](Workspace& ws, size_t& hits, size_t& misses){
+        const size_t h = ws.cacheHits, m = ws.cacheMisses;
+        string out = resolveBankToText(cfg, ws, 1);
+        hits = ws.cacheHits - h; misses = ws.cacheMisses - m;
+        return out;
+    };
+    Workspace ws; ws.cacheDir = dir / "files" / ".cache";
+    ws.banks[1].id = 1; ws.banks[2].id = 2;
+    ws.banks[1].regs[1][1] = "a 2.1.1"; ws.banks[1].regs[1][2] = "plain"; ws.banks[1].regs[1][3] = "@file(inc.txt)";
+    ws.banks[2].regs[1][1] = "old";
+    size_t hits = 0, misses = 0;
+    const string first = run(ws, hits, misses);
+    CHECK(misses == 3 && hits == 0);
+    CHECK(run(ws, hits, misses) == first && hits == 3 && misses == 0);
+
+    ws.banks[2].regs[1][1] = "new"; ws.touchCell(2, 1, 1);
+    const string second = run(ws, hits, misses);
+    CHECK(second.find("a new") != string::npos && second.find("inc new") != string::npos);
+    CHECK(hits == 1 && misses == 2); // only "plain" still valid
+
+    { std::ofstream(dir / "files" / "inc.txt") << "changed 2.1.1"; }
+    CHECK(run(ws, hits, misses).find("changed new") != string::npos && hits == 2 && misses == 1);
+    fs::current_path(old);
+    fs::remove_all(dir);
+}
+
+int main(){
+    moveRangeEmptyRegister();
+    moveRangeSameRegister();
+    moveRangeRefused();
+    moveRangeOtherRegister();
+    resolveRescansSubstitutions();
+    resolveCycles();
+    resolveKeepsNestedIncludes();
+    imageMissLoadsNothing();
+    imageBankResolvesInPlace();
+    tempNames();
+    diffDigestCache();
+    bloomFailsOpen();
+    mergePolicies();
+    overlayCopyOnWrite();
+    frozenLookup();
+    internDedup();
+    compactCellRange();
+    resolveCacheInvalidation();
+    if (failures) { std::cerr << failures << " check(s) failed\n"; return 1; }
+    std::cout << "core_tests: ok\n";
+    return 0;
+}